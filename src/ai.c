@@ -24,12 +24,12 @@
  * directly via email at tvkalvas@cc.jyu.fi
  */
 
+#include "fixed.h"
 #include "game.h"
 #include "terrain.h"
 #include "timer.h"
 #include "tunneler.h"
 #include "types.h"
-#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -40,40 +40,72 @@
  *  3 2 1
  */
 
-/* AI brain parameters */
-unsigned long last_turn[2];
-int evade[2];
-unsigned long evade_time[2];
-
-void Init_AI(void) {
-	last_turn[0] = 0;
-	last_turn[1] = 0;
-	evade_time[0] = 0;
-	evade_time[1] = 0;
-	evade[0] = 0;
-	evade[1] = 0;
+void Init_AI(struct WORLD *w) {
+	int i;
+
+	for(i = 0; i < 2; i++) {
+		w->brain[i].last_turn = 0;
+		w->brain[i].evade_time = 0;
+		w->brain[i].evade = 0;
+	}
 }
 
-int PathClear(int x, int y, double dx, double dy) {
-	int x0, y0;
-	int k;
-	double r;
+/* tan(PI / 8) in fixed point, the edge between two directions */
+#define TAN_PI_8 27146
 
-	r = 0.0;
-	while(r < 100.0) {
-		x0 = Round(x + r * dx);
-		y0 = Round(y + r * dy);
+/* Integer square root, rounded down */
+static Uint64 Isqrt(Uint64 a) {
+	Uint64 r = 0;
+	Uint64 bit = (Uint64)1 << 62;
+
+	while(bit > a) bit >>= 2;
+	while(bit != 0) {
+		if(a >= r + bit) {
+			a -= r + bit;
+			r = (r >> 1) + bit;
+		} else {
+			r >>= 1;
+		}
+		bit >>= 2;
+	}
+
+	return (r);
+}
 
-		k = 0;
-		if(field[y0][x0] > k) k = field[y0][x0];
-		if(field[y0 + 1][x0 + 1] > k) k = field[y0 + 1][x0 + 1];
-		if(field[y0 - 1][x0 + 1] > k) k = field[y0 - 1][x0 + 1];
-		if(field[y0 - 1][x0 - 1] > k) k = field[y0 - 1][x0 - 1];
-		if(field[y0 + 1][x0 - 1] > k) k = field[y0 + 1][x0 - 1];
+/* Direction 0-7 closest to (dx, dy), see the table above */
+static int Direction(Sint32 dx, Sint32 dy) {
+	Sint64 ax = dx < 0 ? -(Sint64)dx : dx;
+	Sint64 ay = dy < 0 ? -(Sint64)dy : dy;
 
-		if(k >= 10) return (0);
+	if(ay * FIX_ONE <= ax * TAN_PI_8) return (dx >= 0 ? 0 : 4);
+	if(ax * FIX_ONE <= ay * TAN_PI_8) return (dy > 0 ? 2 : 6);
+	if(dx > 0) return (dy > 0 ? 1 : 7);
 
-		r += 1.0;
+	return (dy > 0 ? 3 : 5);
+}
+
+/* Is there no rock or wall within 100 cells from (x, y) in
+ * direction (dx, dy), a fixed point unit vector */
+int PathClear(struct WORLD *w, int x, int y, Sint32 dx, Sint32 dy) {
+	Sint32 fx = Int_To_Fix(x);
+	Sint32 fy = Int_To_Fix(y);
+	int x0, y0;
+	int x1, y1;
+	int k, r;
+
+	/* Everything the probe may read, once rather than cell by cell */
+	x1 = Fix_Round(fx + 99 * dx);
+	y1 = Fix_Round(fy + 99 * dy);
+	Touch_Area(w, (y < y1 ? y : y1) - 1, (x < x1 ? x : x1) - 1, (y > y1 ? y : y1) + 1, (x > x1 ? x : x1) + 1);
+
+	for(r = 0; r < 100; r++) {
+		x0 = Fix_Round(fx + r * dx);
+		y0 = Fix_Round(fy + r * dy);
+
+		/* Rock or walls at the center or diagonal corners? */
+		k = PLANE_BIT(w, w->solid, y0 - 1, x0 - 1) | PLANE_BIT(w, w->solid, y0 - 1, x0 + 1) |
+		    PLANE_BIT(w, w->solid, y0 + 1, x0 - 1) | PLANE_BIT(w, w->solid, y0 + 1, x0 + 1);
+		if(k || PLANE_BIT(w, w->solid, y0, x0)) return (0);
 	}
 
 	return (1);
@@ -85,80 +117,74 @@ int PathClear(int x, int y, double dx, double dy) {
  *  using x and y coordinates of tanks, field and bases
  *  and the Energy and Shields
  */
-void Handle_AI(int i) {
+void Handle_AI(struct WORLD *w, int i) {
+	struct TANK *Tank = w->tank;
+	struct BRAIN *b = &w->brain[i];
 	int enemy;
 	int targetx, targety;
-	double dx, dy;
-	double t; /* Direction of movement in rad [-PI,PI] */
+	int x, y; /* Own cell */
+	Sint32 dx, dy;
+	Sint32 ux, uy;
+	Sint64 r;
+	int dir; /* Direction of movement, 0-7 */
 
 	if(i == 0)
 		enemy = 1;
 	else
 		enemy = 0;
 
-	targetx = Tank[enemy].x;
-	targety = Tank[enemy].y;
-
-	/* Get direction */
-	dx = targetx - Tank[i].x;
-	dy = targety - Tank[i].y;
-	t = -1.0 * atan2(dy, dx);
-	dx = cos(t);
-	dy = sin(t);
+	targetx = Tank[enemy].x >> FIX_SHIFT;
+	targety = Tank[enemy].y >> FIX_SHIFT;
+	x = Tank[i].x >> FIX_SHIFT;
+	y = Tank[i].y >> FIX_SHIFT;
+
+	/* Get direction. The path is probed mirrored in y, as it always
+	 * has been. */
+	dx = Int_To_Fix(targetx) - Tank[i].x;
+	dy = Int_To_Fix(targety) - Tank[i].y;
+	r = (Sint64)Isqrt((Uint64)((Sint64)dx * dx + (Sint64)dy * dy));
+	if(r > 0) {
+		ux = (Sint32)(((Sint64)dx << FIX_SHIFT) / r);
+		uy = (Sint32)(-((Sint64)dy << FIX_SHIFT) / r);
+	} else {
+		ux = FIX_ONE;
+		uy = 0;
+	}
+	dir = Direction(dx, dy);
 
-	if(evade[i] == 1) {
-		if(PathClear(Tank[i].x, Tank[i].y, dx, dy)) {
-			printf("Break evade -------------------\n");
-			evade[i] = 0;
+	if(b->evade == 1) {
+		if(PathClear(w, x, y, ux, uy)) {
+			if(Debug) printf("Break evade -------------------\n");
+			b->evade = 0;
 		} else {
-			t += M_PI / 2.0;
-			if(evade_time[i] + 1500 < Time_Now()) evade[i] = 0;
+			/* Turn a quarter counterclockwise */
+			dir = (dir + 6) & 7;
+			if(b->evade_time + 1500 * NS_PER_MS < w->time) b->evade = 0;
 		}
-	} else if(PathClear(Tank[i].x, Tank[i].y, dx, dy)) {
-		printf("t = %lf\t ok!\n", t);
-	} else if(Tank[i].x <= Tank[i].basex + BASE_SIZEX + 5 && Tank[i].x >= Tank[i].basex - BASE_SIZEX - 5 &&
-	          Tank[i].y <= Tank[i].basey + BASE_SIZEY + 5 && Tank[i].y >= Tank[i].basey - BASE_SIZEY - 5) {
-		printf("out of base!\n");
-
-		if(t >= 0.0)
-			t = M_PI / 2.0;
+	} else if(PathClear(w, x, y, ux, uy)) {
+		if(Debug) printf("dir = %d\t ok!\n", dir);
+	} else if(Tank[i].x <= Int_To_Fix(Tank[i].basex + BASE_SIZEX + 5) && Tank[i].x >= Int_To_Fix(Tank[i].basex - BASE_SIZEX - 5) &&
+	          Tank[i].y <= Int_To_Fix(Tank[i].basey + BASE_SIZEY + 5) && Tank[i].y >= Int_To_Fix(Tank[i].basey - BASE_SIZEY - 5)) {
+		if(Debug) printf("out of base!\n");
+
+		if(dy < 0 || (dy == 0 && dx >= 0))
+			dir = 6;
 		else
-			t = -M_PI / 2.0;
+			dir = 2;
 	} else {
 		/* Evasive action! */
-		printf("start evade!\n");
-		evade[i] = 1;
-		evade_time[i] = Time_Now();
+		if(Debug) printf("start evade!\n");
+		b->evade = 1;
+		b->evade_time = w->time;
 	}
 
-	while(t > M_PI) t -= 2.0 * M_PI;
-	while(t < -M_PI) t += 2.0 * M_PI;
-
-	if(Time_Now() > last_turn[i] + 300) {
-		if(t >= -M_PI / 8.0 && t < M_PI / 8.0)
-			Tank[i].rot = 0;
-		else if(t >= -3.0 * M_PI / 8.0 && t < -M_PI / 8.0)
-			Tank[i].rot = 1;
-		else if(t >= -5.0 * M_PI / 8.0 && t < -3.0 * M_PI / 8.0)
-			Tank[i].rot = 2;
-		else if(t >= -7.0 * M_PI / 8.0 && t < -5.0 * M_PI / 8.0)
-			Tank[i].rot = 3;
-		else if(t < -7.0 * M_PI / 8.0 || t >= 7.0 * M_PI / 8.0)
-			Tank[i].rot = 4;
-		else if(t >= 5.0 * M_PI / 8.0 && t < 7.0 * M_PI / 8.0)
-			Tank[i].rot = 5;
-		else if(t >= 3.0 * M_PI / 8.0 && t < 5.0 * M_PI / 8.0)
-			Tank[i].rot = 6;
-		else
-			Tank[i].rot = 7;
-
-		if(Tank[i].rot != Tank[i].oldrot) last_turn[i] = Time_Now();
+	if(w->time > b->last_turn + 300 * NS_PER_MS) {
+		Tank[i].rot = dir;
+		if(Tank[i].rot != Tank[i].oldrot) b->last_turn = w->time;
 	}
 
 	Tank[i].move = 1;
 
 	/* Fire? */
-	dx = targetx - Tank[i].x;
-	dy = targety - Tank[i].y;
-	if(sqrt(dx * dx + dy * dy) < 100) Tank[i].fire = 1;
+	if((Sint64)dx * dx + (Sint64)dy * dy < (Sint64)Int_To_Fix(100) * Int_To_Fix(100)) Tank[i].fire = 1;
 }
@@ -28,7 +28,9 @@
 #ifndef TUNNELER_AI_H
 #define TUNNELER_AI_H
 
-void Init_AI(void);
-void Handle_AI(int i);
+#include "types.h"
+
+void Init_AI(struct WORLD *w);
+void Handle_AI(struct WORLD *w, int i);
 
 #endif /* End of file ai.h */
@@ -0,0 +1,338 @@
+/* batch.c
+ * Parallel batch runner for AI matches
+ * Last modified 17 Oct 2026
+ *
+ * Copyright (c) 2004,2007 Taneli Kalvas
+ *
+ * This file is part of SDL Tunneler
+ *
+ * SDL Tunneler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SDL Tunneler is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SDL Tunneler ; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * Questions, comments and bug reports should be sent to the author
+ * directly via email at tvkalvas@cc.jyu.fi
+ */
+
+#include "config.h"
+#include "game.h"
+#include "headless.h"
+#include "mapfile.h"
+#include "particles.h"
+#include "terrain.h"
+#include "timer.h"
+#include "tunneler.h"
+#include "types.h"
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_THREADS 256
+
+int Debug = 0;
+
+/* Result of a single match */
+struct RESULT {
+	Uint64 seed;
+	Uint64 ticks;
+	Uint64 real; /* ns */
+	Uint64 field; /* ns setting up the field */
+	Uint64 chunk; /* ns making chunks of the field */
+	int chunks; /* Field chunks made during the match */
+	int deaths[2];
+};
+
+/* Work shared by all worker threads */
+static struct RESULT *results;
+static int matches;
+static Uint64 first_seed;
+static Uint64 max_ticks;
+static int max_deaths;
+static int max_ammo = MAX_AMMO;
+static int max_expl = MAX_EXPL;
+static int sizex = FIELD_SIZEX;
+static int sizey = FIELD_SIZEY;
+static const char *map_file = NULL;
+static SDL_atomic_t next_match;
+
+/* Worker thread: plays matches from the shared queue in its own world
+ * until none are left */
+static int Worker(void *data) {
+	struct WORLD *w;
+	struct RESULT *r;
+	Uint64 start;
+	int m;
+
+	((void)data);
+
+	w = malloc(sizeof(struct WORLD));
+	if(w == NULL) {
+		printf("Out of memory\n");
+		exit(1);
+	}
+	memset(w, 0, sizeof(struct WORLD));
+	Init_World(w, max_ammo, max_expl, sizex, sizey);
+
+	while((m = SDL_AtomicAdd(&next_match, 1)) < matches) {
+		r = &results[m];
+		r->seed = first_seed + m;
+
+		start = Clock_Real();
+		r->ticks = Simulate(w, map_file, r->seed, max_ticks, max_deaths);
+		r->real = Clock_Real() - start;
+		r->field = w->field_ns;
+		r->chunk = w->chunk_ns;
+		r->chunks = Chunks_Ready(w);
+
+		r->deaths[0] = w->tank[0].deaths;
+		r->deaths[1] = w->tank[1].deaths;
+	}
+
+	Free_World(w);
+	free(w);
+	return (0);
+}
+
+/* Print results as CSV on stdout, totals on stderr */
+static void Print_Results(Uint64 real) {
+	Uint64 ticks = 0;
+	Uint64 field = 0;
+	Uint64 chunk = 0;
+	Uint64 chunks = 0;
+	int deaths[2] = {0, 0};
+	struct RESULT *r;
+	int m;
+
+	printf("seed,ticks,sim_seconds,deaths_tank1,deaths_tank2,ticks_per_second\n");
+	for(m = 0; m < matches; m++) {
+		r = &results[m];
+
+		printf(
+			"%llu,%llu,%.2f,%d,%d,%.0f\n",
+			(unsigned long long)r->seed,
+			(unsigned long long)r->ticks,
+			(double)r->ticks / TICK_RATE,
+			r->deaths[0],
+			r->deaths[1],
+			r->real > 0 ? (double)r->ticks * NS_PER_SEC / r->real : 0.0
+		);
+
+		ticks += r->ticks;
+		field += r->field;
+		chunk += r->chunk;
+		chunks += r->chunks;
+		deaths[0] += r->deaths[0];
+		deaths[1] += r->deaths[1];
+	}
+
+	fprintf(
+		stderr,
+		"%d matches, %llu ticks in %.3f s, %.0f ticks per second, %.1f ms per field, %.0f chunks made per field in %.1f ms, deaths %d - %d\n",
+		matches,
+		(unsigned long long)ticks,
+		(double)real / NS_PER_SEC,
+		real > 0 ? (double)ticks * NS_PER_SEC / real : 0.0,
+		(double)field / matches / NS_PER_MS,
+		(double)chunks / matches,
+		(double)chunk / matches / NS_PER_MS,
+		deaths[0],
+		deaths[1]
+	);
+}
+
+int main(int argc, char *argv[]) {
+	SDL_Thread *thread[MAX_THREADS];
+	struct WORLD *w;
+	int threads;
+	Uint64 start;
+	int i = 1;
+	int j;
+
+	// Suppress compiler warning about unused argument
+	((void)argc);
+
+	threads = SDL_GetCPUCount();
+	matches = 100;
+	first_seed = 1;
+
+	while(argv[i] != NULL) {
+		if(!strcmp(argv[i], "-threads")) {
+			i++;
+			if(argv[i] == NULL) {
+				printf("-threads needs a numerical argument\n");
+				exit(1);
+			}
+			threads = atoi(argv[i]);
+			if(threads < 1 || threads > MAX_THREADS) {
+				printf("Thread count must be between 1 and %d\n", MAX_THREADS);
+				exit(1);
+			}
+		} else if(!strcmp(argv[i], "-matches")) {
+			i++;
+			if(argv[i] == NULL) {
+				printf("-matches needs a numerical argument\n");
+				exit(1);
+			}
+			matches = atoi(argv[i]);
+			if(matches < 1) {
+				printf("Match count must be positive\n");
+				exit(1);
+			}
+		} else if(!strcmp(argv[i], "-seed") || !strcmp(argv[i], "--seed")) {
+			i++;
+			if(argv[i] == NULL) {
+				printf("--seed needs a numerical argument\n");
+				exit(1);
+			}
+			first_seed = strtoull(argv[i], NULL, 10);
+		} else if(!strcmp(argv[i], "-ticks")) {
+			i++;
+			if(argv[i] == NULL) {
+				printf("-ticks needs a numerical argument\n");
+				exit(1);
+			}
+			max_ticks = strtoull(argv[i], NULL, 10);
+		} else if(!strcmp(argv[i], "-deaths")) {
+			i++;
+			if(argv[i] == NULL) {
+				printf("-deaths needs a numerical argument\n");
+				exit(1);
+			}
+			max_deaths = atoi(argv[i]);
+			if(max_deaths < 0) {
+				printf("Death count can not be negative\n");
+				exit(1);
+			}
+		} else if(!strcmp(argv[i], "-ammo")) {
+			i++;
+			if(argv[i] == NULL) {
+				printf("-ammo needs a numerical argument\n");
+				exit(1);
+			}
+			max_ammo = atoi(argv[i]);
+			if(max_ammo < 1) {
+				printf("Ammo count must be positive\n");
+				exit(1);
+			}
+		} else if(!strcmp(argv[i], "-particles")) {
+			i++;
+			if(argv[i] == NULL) {
+				printf("-particles needs a numerical argument\n");
+				exit(1);
+			}
+			max_expl = atoi(argv[i]);
+			if(max_expl < 1) {
+				printf("Particle count must be positive\n");
+				exit(1);
+			}
+		} else if(!strcmp(argv[i], "-map")) {
+			i++;
+			if(argv[i] == NULL) {
+				printf("-map needs an argument\n");
+				exit(1);
+			}
+			if(!Parse_Field_Size(argv[i], &sizex, &sizey)) {
+				printf("Map size must be WxH, from %dx%d to %dx%d\n", FIELD_MINX, FIELD_MINY, FIELD_MAX, FIELD_MAX);
+				exit(1);
+			}
+		} else if(!strcmp(argv[i], "-loadmap")) {
+			i++;
+			if(argv[i] == NULL) {
+				printf("-loadmap needs a file name\n");
+				exit(1);
+			}
+			map_file = argv[i];
+		} else if(!strcmp(argv[i], "-version") || !strcmp(argv[i], "--version")) {
+			printf("SDL Tunneler batch runner v." VERSION "\n");
+			exit(1);
+		} else {
+			printf("Tunneler batch runner v." VERSION "\n");
+			printf("\n");
+			printf("Usage: tunneler-batch [options]\n");
+			printf("  -threads n     number of worker threads (default: CPU count)\n");
+			printf("  -matches m     number of matches to play (default: 100)\n");
+			printf("  --seed n       seed of the first match, others follow (default: 1)\n");
+			printf("  -ticks n       stop each match after n ticks (%d per second)\n", TICK_RATE);
+			printf("  -deaths n      stop each match when a tank has died n times\n");
+			printf("  -ammo n        allow n shots in flight per tank (default: %d)\n", MAX_AMMO);
+			printf("  -particles n   allow n explosion particles (default: %d)\n", MAX_EXPL);
+			printf("  -map WxH       play on a W by H field (default: %dx%d)\n", FIELD_SIZEX, FIELD_SIZEY);
+			printf("  -loadmap file  play every match on the map in file\n");
+			printf("  --version      display version\n");
+			return (0);
+		}
+
+		i++;
+	}
+
+	/* Default to an hour of play */
+	if(max_ticks == 0 && max_deaths == 0) max_ticks = 3600 * TICK_RATE;
+	if(threads > matches) threads = matches;
+
+	results = calloc(matches, sizeof(struct RESULT));
+	if(results == NULL) {
+		printf("Out of memory\n");
+		exit(1);
+	}
+
+	Init_Clock();
+	Init_Particles();
+	Init_Terrain();
+	Init_Footprints();
+
+	/* Check the map once before the threads start, it sets the size */
+	if(map_file != NULL) {
+		w = calloc(1, sizeof(struct WORLD));
+		if(w == NULL) {
+			printf("Out of memory\n");
+			exit(1);
+		}
+		Alloc_Field(w, sizex, sizey);
+		if(!Load_Map(w, map_file)) exit(1);
+		sizex = w->sizex;
+		sizey = w->sizey;
+		Free_Field(w);
+		free(w);
+	}
+
+	/* One field per worker */
+	fprintf(
+		stderr,
+		"Map %dx%d, %.1f MiB of address space per world, %.1f MiB for %d threads\n",
+		sizex,
+		sizey,
+		(double)Field_Bytes(sizex, sizey) / (1 << 20),
+		(double)Field_Bytes(sizex, sizey) * threads / (1 << 20),
+		threads
+	);
+
+	start = Clock_Real();
+	SDL_AtomicSet(&next_match, 0);
+
+	for(j = 0; j < threads; j++) {
+		thread[j] = SDL_CreateThread(Worker, "worker", NULL);
+		if(thread[j] == NULL) {
+			printf("Unable to create thread: %s\n", SDL_GetError());
+			exit(1);
+		}
+	}
+	for(j = 0; j < threads; j++) SDL_WaitThread(thread[j], NULL);
+
+	Print_Results(Clock_Real() - start);
+
+	free(results);
+	return (0);
+}
+
+/* End of file batch.c */
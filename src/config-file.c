@@ -31,6 +31,7 @@
 #include "graphics.h"
 #include "keys.h"
 #include "terrain.h"
+#include "timer.h"
 #include "tunneler.h"
 #include "types.h"
 
@@ -300,6 +301,9 @@ void Write_Config(void) {
 	fprintf(fp, "fullscreen = %d\n", !!Video_fullscreen);
 	fprintf(fp, "width = %d\n", Video_X);
 	fprintf(fp, "height = %d\n", Video_Y);
+	fprintf(fp, "renderer = %d\n", Video_backend);
+	fprintf(fp, "vsync = %d\n", !!Video_vsync);
+	fprintf(fp, "fps = %d\n", Frame_rate);
 
 	fprintf(fp, "pl0_up = %d\n", sym_pl[0].up);
 	fprintf(fp, "pl0_down = %d\n", sym_pl[0].down);
@@ -367,6 +371,9 @@ static const struct ConfigKey CONFIG_KEYS[] = {
 	CONFKEY("fullscreen", Video_fullscreen, 0),
 	CONFKEY("width", Video_X, 0),
 	CONFKEY("height", Video_Y, 0),
+	CONFKEY("renderer", Video_backend, 0),
+	CONFKEY("vsync", Video_vsync, 0),
+	CONFKEY("fps", Frame_rate, 0),
 	CONFKEY("pl0_up", sym_pl[0].up, 1),
 	CONFKEY("pl0_right", sym_pl[0].right, 1),
 	CONFKEY("pl0_down", sym_pl[0].down, 1),
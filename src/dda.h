@@ -0,0 +1,118 @@
+/* dda.h
+ * Grid traversal Header
+ * Last modified 17 Oct 2026
+ *
+ * Copyright (c) 2004,2007 Taneli Kalvas
+ *
+ * This file is part of SDL Tunneler
+ *
+ * SDL Tunneler is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * SDL Tunneler is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SDL Tunneler ; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * Questions, comments and bug reports should be sent to the author
+ * directly via email at tvkalvas@cc.jyu.fi
+ */
+
+#ifndef TUNNELER_DDA_H
+#define TUNNELER_DDA_H
+
+#include "fixed.h"
+#include <SDL2/SDL.h>
+#include <stdlib.h>
+
+/*  Grid traversal
+ *
+ *  Visits every field cell crossed by a segment exactly once, in the
+ *  order they are crossed (Amanatides & Woo). Cell (x, y) covers
+ *  [x - 0.5, x + 0.5), so the first cell is the one given by Round().
+ *  Only integer arithmetic is used once started.
+ *
+ *  DDA_Start(&d, x, y, dx, dy);
+ *  do {
+ *      test cell d.x, d.y, break if hit
+ *  } while(DDA_Step(&d));
+ */
+struct DDA {
+	int x, y; /* Current cell */
+	int px, py; /* Previous cell, same as current at start */
+	int sx, sy; /* Step direction */
+	Sint64 fx, fy; /* Distance to next cell boundary, fixed point */
+	Sint64 ax, ay; /* Length of segment along axes, fixed point */
+	int left; /* Cells left to visit */
+};
+
+/* Start traversal of segment from (x, y) to (x + dx, y + dy), given
+ * in fixed point. Positions must not be negative. */
+static inline void DDA_Start(struct DDA *d, Sint32 x, Sint32 y, Sint32 dx, Sint32 dy) {
+	Sint64 ux = (Sint64)x + FIX_HALF;
+	Sint64 uy = (Sint64)y + FIX_HALF;
+
+	d->x = (int)(ux >> FIX_SHIFT);
+	d->y = (int)(uy >> FIX_SHIFT);
+	d->px = d->x;
+	d->py = d->y;
+	d->left = abs((int)((ux + dx) >> FIX_SHIFT) - d->x) + abs((int)((uy + dy) >> FIX_SHIFT) - d->y);
+
+	if(dx > 0) {
+		d->sx = 1;
+		d->fx = ((Sint64)(d->x + 1) << FIX_SHIFT) - ux;
+		d->ax = dx;
+	} else if(dx < 0) {
+		d->sx = -1;
+		d->fx = ux - ((Sint64)d->x << FIX_SHIFT);
+		d->ax = -(Sint64)dx;
+	} else {
+		d->sx = 0;
+		d->fx = FIX_ONE;
+		d->ax = 0;
+	}
+
+	if(dy > 0) {
+		d->sy = 1;
+		d->fy = ((Sint64)(d->y + 1) << FIX_SHIFT) - uy;
+		d->ay = dy;
+	} else if(dy < 0) {
+		d->sy = -1;
+		d->fy = uy - ((Sint64)d->y << FIX_SHIFT);
+		d->ay = -(Sint64)dy;
+	} else {
+		d->sy = 0;
+		d->fy = FIX_ONE;
+		d->ay = 0;
+	}
+}
+
+/* Move to the next cell, returns 0 at the end of the segment. The
+ * boundary reached first is the one with the smaller fx / ax or
+ * fy / ay, compared without dividing. */
+static inline int DDA_Step(struct DDA *d) {
+	if(d->left == 0) return (0);
+
+	d->left--;
+	d->px = d->x;
+	d->py = d->y;
+
+	if(d->fx * d->ay <= d->fy * d->ax) {
+		d->x += d->sx;
+		d->fx += FIX_ONE;
+	} else {
+		d->y += d->sy;
+		d->fy += FIX_ONE;
+	}
+
+	return (1);
+}
+
+#endif /* End of file dda.h */
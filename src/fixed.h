@@ -0,0 +1,65 @@
+/* fixed.h
+ * Fixed point arithmetic Header
+ * Last modified 17 Oct 2026
+ *
+ * Copyright (c) 2004,2007 Taneli Kalvas
+ *
+ * This file is part of SDL Tunneler
+ *
+ * SDL Tunneler is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * SDL Tunneler is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SDL Tunneler ; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * Questions, comments and bug reports should be sent to the author
+ * directly via email at tvkalvas@cc.jyu.fi
+ */
+
+#ifndef TUNNELER_FIXED_H
+#define TUNNELER_FIXED_H
+
+#include <SDL2/SDL.h>
+#include <math.h>
+
+/* Positions are 16.16 fixed point, cell (x, y) covers [x - 0.5, x + 0.5).
+ * Integer arithmetic keeps the simulation bit exact everywhere. */
+#define FIX_SHIFT 16
+#define FIX_ONE   (1 << FIX_SHIFT)
+#define FIX_HALF  (FIX_ONE / 2)
+
+/* Constant expression for a non-negative compile time constant */
+#define FIX_CONST(a) ((Sint32)((a) * FIX_ONE + 0.5))
+
+static inline Sint32 To_Fix(double a) {
+	return ((Sint32)floor(a * FIX_ONE + 0.5));
+}
+
+static inline double Fix_To_Double(Sint32 a) {
+	return ((double)a / FIX_ONE);
+}
+
+static inline Sint32 Int_To_Fix(int a) {
+	return ((Sint32)a * FIX_ONE);
+}
+
+/* Cell containing a, same as Round() */
+static inline int Fix_Round(Sint32 a) {
+	return ((a + FIX_HALF) >> FIX_SHIFT);
+}
+
+/* a * b, both fixed point */
+static inline Sint32 Fix_Mul(Sint32 a, Sint32 b) {
+	return ((Sint32)(((Sint64)a * b) >> FIX_SHIFT));
+}
+
+#endif /* End of file fixed.h */
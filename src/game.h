@@ -38,11 +38,22 @@
 
 /* Gameworld related configuration */
 
-#define FIELD_SIZEX 800
+#define TICK_RATE    100 /* Simulation ticks per second */
+#define TICK_TIME    (1.0 / TICK_RATE)
+#define TICK_NS      (1000000000ULL / TICK_RATE)
+#define MAX_FRAME_NS 250000000ULL /* Longest time simulated between two frames */
+
+#define MAX_AMMO 128 /* Default maximum of shots per tank */
+#define MAX_EXPL 128 /* Default maximum of explosion particles */
+
+#define FIELD_SIZEX 800   /* Default field size */
 #define FIELD_SIZEY 600
+#define FIELD_MINX  480   /* Room for the borders and two bases */
+#define FIELD_MINY  360
+#define FIELD_MAX   16384 /* Largest field side */
 
 #define TANK_SPEED    30.0
-#define FIRE_DELAY    150
+#define FIRE_DELAY    150 /* ms */
 #define AMMO_SPEED    60.0
 #define PART_SPEED    60.0
 #define DIG_SPEED     10.0
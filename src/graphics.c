@@ -31,31 +31,81 @@
 #include <SDL2/SDL.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-unsigned char font8x8[8][8][256];
+/* Each byte of a glyph row bitmask expanded to 8 byte masks */
+static Uint64 font_rows[256];
 SDL_Window *window;
 SDL_Surface *screen;
 Uint32 color[256];
 
+/* Used by the SDL_Renderer backends only. In those, screen is an
+ * offscreen surface in the same format as the textures. */
+static SDL_Renderer *renderer = NULL;
+static SDL_Texture *texture = NULL;
+static SDL_Texture *phys_texture = NULL;
+
+/* Back buffer at native resolution, holding indices into color[] */
+Uint8 framebuffer[RES_Y][RES_X];
+
 int Video_fullscreen = 0;
 int Video_X = 800;
 int Video_Y = 600;
+int Video_backend = VIDEO_SURFACE;
+int Video_vsync = 1;
 
 void Init_Font(void) {
-	int a, x, y;
-	unsigned char c;
+	int a, x;
+	Uint8 row[8];
 
 	for(a = 0; a < 256; a++) {
-		for(y = 0; y < 8; y++) {
-			c = raw_font8x8[8 * a + y];
-			for(x = 0; x < 8; x++) {
-				if((c & 128) == 128)
-					font8x8[x][y][a] = 1;
-				else
-					font8x8[x][y][a] = 0;
-				c = c << 1;
-			}
-		}
+		for(x = 0; x < 8; x++) row[x] = (a & (128 >> x)) ? 0xff : 0x00;
+		memcpy(&font_rows[a], row, 8);
+	}
+}
+
+static void CloseWindow(void) {
+	if(phys_texture != NULL) SDL_DestroyTexture(phys_texture);
+	if(texture != NULL) SDL_DestroyTexture(texture);
+	if(renderer != NULL) {
+		SDL_DestroyRenderer(renderer);
+		SDL_FreeSurface(screen);
+	}
+	if(window != NULL) SDL_DestroyWindow(window);
+
+	phys_texture = NULL;
+	texture = NULL;
+	renderer = NULL;
+	screen = NULL;
+	window = NULL;
+}
+
+static void OpenRenderer(void) {
+	Uint32 flags = 0;
+
+	if(Video_backend == VIDEO_SOFTWARE) flags |= SDL_RENDERER_SOFTWARE;
+	if(Video_vsync) flags |= SDL_RENDERER_PRESENTVSYNC;
+
+	SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "nearest");
+	renderer = SDL_CreateRenderer(window, -1, flags);
+	if(renderer == NULL) {
+		printf("Failed to create renderer: %s\n", SDL_GetError());
+		exit(1);
+	}
+
+	/* Scaling to window size is left to the renderer */
+	SDL_RenderSetLogicalSize(renderer, RES_X, RES_Y);
+
+	texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, RES_X, RES_Y);
+	if(texture == NULL) {
+		printf("Failed to create texture: %s\n", SDL_GetError());
+		exit(1);
+	}
+
+	screen = SDL_CreateRGBSurfaceWithFormat(0, Video_X, Video_Y, 32, SDL_PIXELFORMAT_ARGB8888);
+	if(screen == NULL) {
+		printf("Failed to create surface: %s\n", SDL_GetError());
+		exit(1);
 	}
 }
 
@@ -63,6 +113,8 @@ void OpenWindow(void) {
 	int flags = SDL_WINDOW_SHOWN;
 	if(Video_fullscreen) flags |= SDL_WINDOW_FULLSCREEN_DESKTOP;
 
+	CloseWindow();
+
 	window = SDL_CreateWindow(
 		"Tunneler v." VERSION, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, Video_X, Video_Y, SDL_WINDOW_SHOWN
 	);
@@ -71,6 +123,11 @@ void OpenWindow(void) {
 		exit(1);
 	}
 
+	if(Video_backend != VIDEO_SURFACE) {
+		OpenRenderer();
+		return;
+	}
+
 	screen = SDL_GetWindowSurface(window);
 	if(screen == NULL) {
 		printf("Failed to retrieve window surface: %s\n", SDL_GetError());
@@ -146,8 +203,8 @@ void Init_Video(void) {
 	color[68] = SDL_MapRGB(screen->format, 0x22, 0x33, 0x22);
 	color[69] = SDL_MapRGB(screen->format, 0xaa, 0xaa, 0xaa);
 
-	SDL_FillRect(screen, NULL, color[0]);
-	SDL_UpdateWindowSurface(window);
+	FillScreen(0);
+	Present();
 
 	return;
 }
@@ -183,46 +240,180 @@ void PutPhysPixel(int x, int y, Uint32 color) {
 	}
 }
 
-void PutPixel(int x, int y, Uint32 color) {
-	SDL_Rect rect;
+static void FillPhysSpan(Uint8 *p, int n, int bpp, Uint32 color) {
+	int i;
+
+	switch(bpp) {
+		case 1:
+			memset(p, color, n);
+			break;
+
+		case 2:
+			for(i = 0; i < n; i++) ((Uint16 *)p)[i] = color;
+			break;
 
-	rect.x = Video_X * x / RES_X;
-	rect.y = Video_Y * y / RES_Y;
-	rect.w = Video_X * (x + 1) / RES_X - Video_X * x / RES_X;
-	rect.h = Video_Y * (y + 1) / RES_Y - Video_Y * y / RES_Y;
+		case 3:
+			for(i = 0; i < n; i++, p += 3) {
+				if(SDL_BYTEORDER == SDL_BIG_ENDIAN) {
+					p[0] = (color >> 16) & 0xff;
+					p[1] = (color >> 8) & 0xff;
+					p[2] = color & 0xff;
+				} else {
+					p[0] = color & 0xff;
+					p[1] = (color >> 8) & 0xff;
+					p[2] = (color >> 16) & 0xff;
+				}
+			}
+			break;
 
-	SDL_FillRect(screen, &rect, color);
+		case 4:
+			for(i = 0; i < n; i++) ((Uint32 *)p)[i] = color;
+			break;
+	}
 }
 
-void PutChar(int x, int y, char ch, Uint32 color) {
-	int i, j;
+/* Convert the back buffer to the streaming texture at native
+ * resolution and let the renderer scale it up. */
+static void PresentRenderer(void) {
+	int x, y;
+	int pitch;
+	void *pixels;
+	Uint32 *row;
 
-	for(i = 0; i < 8; i++) {
-		for(j = 0; j < 8; j++) {
-			if(font8x8[j][i][(int)ch]) PutPixel(x + j, y + i, color);
+	if(SDL_LockTexture(texture, NULL, &pixels, &pitch) < 0) {
+		printf("Failed to lock texture: %s\n", SDL_GetError());
+		exit(1);
+	}
+
+	for(y = 0; y < RES_Y; y++) {
+		row = (Uint32 *)((Uint8 *)pixels + y * pitch);
+		for(x = 0; x < RES_X; x++) row[x] = color[framebuffer[y][x]];
+	}
+
+	SDL_UnlockTexture(texture);
+
+	SDL_RenderClear(renderer);
+	SDL_RenderCopy(renderer, texture, NULL, NULL);
+	SDL_RenderPresent(renderer);
+}
+
+/* Convert the back buffer to the window surface, scaling it up to
+ * window size, and show the result. Each logical row is converted
+ * once and then copied to the rest of the physical rows it covers. */
+void Present(void) {
+	int x, y, r;
+	int x0, x1, y0, y1;
+	int bpp;
+	Uint8 *row;
+
+	if(renderer != NULL) {
+		PresentRenderer();
+		return;
+	}
+
+	SDL_LockSurface(screen);
+	bpp = screen->format->BytesPerPixel;
+
+	for(y = 0; y < RES_Y; y++) {
+		y0 = screen->h * y / RES_Y;
+		y1 = screen->h * (y + 1) / RES_Y;
+		if(y0 == y1) continue;
+
+		row = (Uint8 *)screen->pixels + y0 * screen->pitch;
+		for(x = 0; x < RES_X; x++) {
+			x0 = screen->w * x / RES_X;
+			x1 = screen->w * (x + 1) / RES_X;
+			FillPhysSpan(row + x0 * bpp, x1 - x0, bpp, color[framebuffer[y][x]]);
 		}
+
+		for(r = y0 + 1; r < y1; r++) memcpy(row + (r - y0) * screen->pitch, row, screen->w * bpp);
 	}
+
+	SDL_UnlockSurface(screen);
+	SDL_UpdateWindowSurface(window);
 }
 
-void PutStr(int x, int y, char *str, Uint32 color) {
-	int i = 0;
+/* Show contents of screen, drawn with PutPhysPixel() */
+void PresentPhys(void) {
+	if(renderer == NULL) {
+		SDL_UpdateWindowSurface(window);
+		return;
+	}
 
-	while(*str) {
-		PutChar(x + i, y, *str, color);
-		i += 8;
-		str++;
+	if(phys_texture == NULL) {
+		phys_texture = SDL_CreateTexture(
+			renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, screen->w, screen->h
+		);
+		if(phys_texture == NULL) {
+			printf("Failed to create texture: %s\n", SDL_GetError());
+			exit(1);
+		}
 	}
+
+	SDL_UpdateTexture(phys_texture, NULL, screen->pixels, screen->pitch);
+	SDL_RenderClear(renderer);
+	SDL_RenderCopy(renderer, phys_texture, NULL, NULL);
+	SDL_RenderPresent(renderer);
+}
+
+void FillScreen(Uint8 color) {
+	memset(framebuffer, color, sizeof(framebuffer));
 }
 
-void DrawBox(int x, int y, int w, int h, Uint32 color) {
-	SDL_Rect rect;
+void PutPixel(int x, int y, Uint8 color) {
+	if(x < 0 || x >= RES_X || y < 0 || y >= RES_Y) return;
 
-	rect.x = Video_X * x / RES_X;
-	rect.y = Video_Y * y / RES_Y;
-	rect.w = Video_X * (x + w) / RES_X - Video_X * x / RES_X;
-	rect.h = Video_Y * (y + h) / RES_Y - Video_Y * y / RES_Y;
+	framebuffer[y][x] = color;
+}
+
+/* Write 8 pixels at once where mask is set */
+static void PutRow(Uint8 *dst, Uint64 pixels, Uint64 mask) {
+	Uint64 d;
+
+	memcpy(&d, dst, 8);
+	d = (pixels & mask) | (d & ~mask);
+	memcpy(dst, &d, 8);
+}
+
+void PutChar(int x, int y, char ch, Uint8 color) {
+	const unsigned char *glyph = &raw_font8x8[8 * (unsigned char)ch];
+	Uint64 fill = color * 0x0101010101010101ULL;
+	int i, j;
+
+	if(x < 0 || x > RES_X - 8 || y < 0 || y > RES_Y - 8) {
+		for(i = 0; i < 8; i++) {
+			for(j = 0; j < 8; j++) {
+				if(glyph[i] & (128 >> j)) PutPixel(x + j, y + i, color);
+			}
+		}
+		return;
+	}
+
+	for(i = 0; i < 8; i++) PutRow(&framebuffer[y + i][x], fill, font_rows[glyph[i]]);
+}
+
+void PutStr(int x, int y, char *str, Uint8 color) {
+	int i;
+
+	for(i = 0; *str; i += 8, str++) PutChar(x + i, y, *str, color);
+}
+
+void DrawBox(int x, int y, int w, int h, Uint8 color) {
+	int j;
+
+	if(x < 0) {
+		w += x;
+		x = 0;
+	}
+	if(y < 0) {
+		h += y;
+		y = 0;
+	}
+	if(x + w > RES_X) w = RES_X - x;
+	if(y + h > RES_Y) h = RES_Y - y;
+	if(w <= 0 || h <= 0) return;
 
-	SDL_FillRect(screen, &rect, color);
+	for(j = y; j < y + h; j++) memset(&framebuffer[j][x], color, w);
 }
 
 /* End of file graphics.c */
@@ -33,23 +33,38 @@
 #define RES_X 160
 #define RES_Y 120
 
+/* Presentation backends */
+#define VIDEO_SURFACE  0 /* Window surface, scaled on CPU */
+#define VIDEO_RENDERER 1 /* SDL_Renderer, any driver */
+#define VIDEO_SOFTWARE 2 /* SDL_Renderer, software driver */
+
 extern SDL_Window *window;
 extern SDL_Surface *screen;
 extern Uint32 color[256];
+extern Uint8 framebuffer[RES_Y][RES_X];
 
 extern int Video_fullscreen;
 extern int Video_X;
 extern int Video_Y;
+extern int Video_backend;
+extern int Video_vsync;
 
 void OpenWindow(void);
 
 void Init_Font(void);
 void Init_Video(void);
 
+void Present(void);
+void PresentPhys(void);
+
+/* Drawing to the physical window surface, color is a mapped value */
 void PutPhysPixel(int x, int y, Uint32 color);
-void PutPixel(int x, int y, Uint32 color);
-void PutChar(int x, int y, char ch, Uint32 color);
-void PutStr(int x, int y, char *str, Uint32 color);
-void DrawBox(int x, int y, int w, int h, Uint32 color);
+
+/* Drawing to the back buffer, color is an index to color[] */
+void FillScreen(Uint8 color);
+void PutPixel(int x, int y, Uint8 color);
+void PutChar(int x, int y, char ch, Uint8 color);
+void PutStr(int x, int y, char *str, Uint8 color);
+void DrawBox(int x, int y, int w, int h, Uint8 color);
 
 #endif /* End of file graphics.h */
@@ -0,0 +1,97 @@
+/* headless.c
+ * Simulation without video
+ * Last modified 17 Oct 2026
+ *
+ * Copyright (c) 2004,2007 Taneli Kalvas
+ *
+ * This file is part of SDL Tunneler
+ *
+ * SDL Tunneler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SDL Tunneler is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SDL Tunneler ; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * Questions, comments and bug reports should be sent to the author
+ * directly via email at tvkalvas@cc.jyu.fi
+ */
+
+#include "headless.h"
+#include "ai.h"
+#include "game.h"
+#include "mapfile.h"
+#include "rng.h"
+#include "terrain.h"
+#include "timer.h"
+#include "tunneler.h"
+#include "types.h"
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*  Simulate
+ *
+ *  Plays a new match from seed in w with both tanks under AI control,
+ *  as fast as possible. The field is loaded from map_file, or generated
+ *  if it is NULL. Stops after max_ticks ticks or when either tank has died
+ *  max_deaths times, a limit of 0 is ignored. Returns the number of
+ *  ticks simulated.
+ */
+Uint64 Simulate(struct WORLD *w, const char *map_file, Uint64 seed, Uint64 max_ticks, int max_deaths) {
+	Uint64 n;
+
+	Seed_World(w, seed);
+
+	w->tank[0].mode = TANK_AI;
+	w->tank[1].mode = TANK_AI;
+
+	if(map_file == NULL)
+		Init_Field(w);
+	else if(!Load_Map(w, map_file))
+		exit(1);
+	Init_Tanks(w);
+	Init_AI(w);
+
+	for(n = 0; max_ticks == 0 || n < max_ticks; n++) {
+		if(max_deaths > 0 && (w->tank[0].deaths >= max_deaths || w->tank[1].deaths >= max_deaths)) break;
+
+		HandleActions(w);
+	}
+
+	return (n);
+}
+
+/* Run a single match without video and print the results as
+ * key=value lines */
+void Headless(struct WORLD *w, const char *map_file, Uint64 seed, Uint64 max_ticks, int max_deaths) {
+	Uint64 start, real;
+	Uint64 n;
+
+	start = Clock_Real();
+	n = Simulate(w, map_file, seed, max_ticks, max_deaths);
+	real = Clock_Real() - start;
+
+	printf("seed=%llu\n", (unsigned long long)seed);
+	printf("map=%dx%d\n", w->sizex, w->sizey);
+	printf("map_bytes=%llu\n", (unsigned long long)w->map_bytes);
+	printf("ticks=%llu\n", (unsigned long long)n);
+	printf("sim_seconds=%.2f\n", (double)w->time / NS_PER_SEC);
+	printf("real_seconds=%.6f\n", (double)real / NS_PER_SEC);
+	printf("field_seconds=%.6f\n", (double)w->field_ns / NS_PER_SEC);
+	printf("chunk_seconds=%.6f\n", (double)w->chunk_ns / NS_PER_SEC);
+	printf("field_chunks=%d/%d\n", Chunks_Ready(w), w->chunksx * w->chunksy);
+	printf("ticks_per_second=%.0f\n", real > 0 ? (double)n * NS_PER_SEC / real : 0.0);
+	/* Same as shown by Print_Stats() */
+	printf("victories_tank1=%d\n", w->tank[1].deaths);
+	printf("victories_tank2=%d\n", w->tank[0].deaths);
+}
+
+/* End of file headless.c */
@@ -0,0 +1,37 @@
+/* headless.h
+ * Simulation without video Header
+ * Last modified 17 Oct 2026
+ *
+ * Copyright (c) 2004,2007 Taneli Kalvas
+ *
+ * This file is part of SDL Tunneler
+ *
+ * SDL Tunneler is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * SDL Tunneler is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SDL Tunneler ; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * Questions, comments and bug reports should be sent to the author
+ * directly via email at tvkalvas@cc.jyu.fi
+ */
+
+#ifndef TUNNELER_HEADLESS_H
+#define TUNNELER_HEADLESS_H
+
+#include "types.h"
+#include <SDL2/SDL.h>
+
+Uint64 Simulate(struct WORLD *w, const char *map_file, Uint64 seed, Uint64 max_ticks, int max_deaths);
+void Headless(struct WORLD *w, const char *map_file, Uint64 seed, Uint64 max_ticks, int max_deaths);
+
+#endif /* End of file headless.h */
@@ -32,9 +32,6 @@
 /* Keyboard definitions */
 player_keys_t sym_pl[2];
 
-/* Current keyboard status */
-player_keys_t key_pl[2];
-
 /* Keyboard status for menu buttons */
 int key_quit = 0;
 int key_menu_enter = 0;
@@ -43,13 +40,14 @@ int key_menu_down = 0;
 int key_menu_left = 0;
 int key_menu_right = 0;
 
-void HandleKeyEvent(SDL_KeyboardEvent *key) {
+/* Update menu keys, and player keys in key_pl[2] unless it is NULL */
+void HandleKeyEvent(SDL_KeyboardEvent *key, player_keys_t *key_pl) {
 	if(key->type == SDL_KEYDOWN || key->type == SDL_KEYUP) {
 		int i;
 		int b = key->type == SDL_KEYDOWN ? 1 : 0;
 
 		/* Player keys */
-		for(i = 0; i < 2; i++) {
+		for(i = 0; i < 2 && key_pl != NULL; i++) {
 			if(key->keysym.sym == sym_pl[i].up)
 				key_pl[i].up = b;
 			else if(key->keysym.sym == sym_pl[i].down)
@@ -34,9 +34,6 @@
 /* Keyboard definitions */
 extern player_keys_t sym_pl[2];
 
-/* Current keyboard status */
-extern player_keys_t key_pl[2];
-
 /* Keyboard status for menu buttons */
 extern int key_quit;
 extern int key_menu_enter;
@@ -45,6 +42,6 @@ extern int key_menu_down;
 extern int key_menu_left;
 extern int key_menu_right;
 
-void HandleKeyEvent(SDL_KeyboardEvent *key);
+void HandleKeyEvent(SDL_KeyboardEvent *key, player_keys_t *key_pl);
 
 #endif /* End of file keys.h */
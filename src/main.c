@@ -30,8 +30,13 @@
 #include "config.h"
 #include "game.h"
 #include "graphics.h"
+#include "headless.h"
 #include "keys.h"
+#include "mapfile.h"
+#include "particles.h"
+#include "rng.h"
 #include "terrain.h"
+#include "timer.h"
 #include "tunneler.h"
 #include "types.h"
 
@@ -41,12 +46,30 @@
 #include <string.h>
 #include <time.h>
 
-void HandleEvents(void) {
+/* Longest time to block waiting for events in menus, in ms */
+#define MENU_TIMEOUT 1000
+
+int Debug = 0;
+
+/* The match played on screen */
+static struct WORLD world;
+
+/* Map file played on instead of generated fields, or NULL */
+static const char *map_file = NULL;
+
+/* File to save the generated field in, or NULL */
+static const char *save_file = NULL;
+
+/* Menu wakeup counter */
+static Uint32 wakeups = 0;
+static Uint32 wakeup_time = 0;
+
+void HandleEvents(struct WORLD *w) {
 	SDL_Event event;
 
 	while(SDL_PollEvent(&event)) {
 		if(event.type == SDL_KEYDOWN || event.type == SDL_KEYUP)
-			HandleKeyEvent(&event.key);
+			HandleKeyEvent(&event.key, w->keys);
 		else if(event.type == SDL_QUIT) {
 			printf("Fast quit\n");
 			exit(1);
@@ -54,28 +77,83 @@ void HandleEvents(void) {
 	}
 }
 
+static void CountWakeup(void) {
+	Uint32 now;
+
+	wakeups++;
+	now = SDL_GetTicks();
+	if(now - wakeup_time >= 1000) {
+		if(Debug) printf("Menu wakeups: %.1f/s\n", 1000.0 * wakeups / (now - wakeup_time));
+		wakeups = 0;
+		wakeup_time = now;
+	}
+}
+
+/* Block until there are events or MENU_TIMEOUT has passed and handle
+ * them. Returns nonzero if the window needs to be redrawn. */
+int WaitEvents(void) {
+	SDL_Event event;
+	int redraw = 0;
+
+	if(SDL_WaitEventTimeout(&event, MENU_TIMEOUT)) {
+		do {
+			if(event.type == SDL_KEYDOWN || event.type == SDL_KEYUP)
+				HandleKeyEvent(&event.key, NULL);
+			else if(event.type == SDL_WINDOWEVENT)
+				redraw = 1;
+			else if(event.type == SDL_QUIT) {
+				printf("Fast quit\n");
+				exit(1);
+			}
+		} while(SDL_PollEvent(&event));
+	}
+
+	CountWakeup();
+	return (redraw);
+}
+
+/* Wait until enter or escape is pressed, showing the screen again
+ * with present() whenever the window needs it */
+void WaitEnter(void (*present)(void)) {
+	key_menu_enter = 0;
+	key_quit = 0;
+
+	while(!key_quit) {
+		if(WaitEvents()) present();
+
+		if(key_menu_enter) {
+			key_menu_enter = 0;
+			break;
+		}
+	}
+
+	key_quit = 0;
+}
+
 int GetKeyPress(void) {
 	SDL_KeyboardEvent *key;
 	SDL_Event event;
 
 	while(1) {
-		while(SDL_PollEvent(&event)) {
+		if(SDL_WaitEventTimeout(&event, MENU_TIMEOUT)) {
 			if(event.type == SDL_KEYDOWN) {
 				key = &event.key;
 				return (key->keysym.sym);
+			} else if(event.type == SDL_WINDOWEVENT) {
+				Present();
 			} else if(event.type == SDL_QUIT) {
 				printf("Fast quit\n");
 				exit(1);
 			}
 		}
 
-		SDL_Delay(50);
+		CountWakeup();
 	}
 
 	return (0);
 }
 
-void PrintKey(int x, int y, int key, Uint32 color) {
+void PrintKey(int x, int y, int key, Uint8 color) {
 	char str[22];
 
 	switch(key) {
@@ -273,13 +351,49 @@ void PrintKey(int x, int y, int key, Uint32 color) {
 	PutStr(x, y, str, color);
 }
 
-void Settings(void) {
-	int j = 0;
+void Draw_Settings(int j) {
 	char str[22];
 	char str2[22];
 
+	FillScreen(0);
+
+	PutStr(6 * 8, 2 * 8, "Settings", 12);
+	PutStr(1 * 8, 4 * 8, "Fullscreen:", 12);
+	PutStr(1 * 8, 5 * 8, "Mode:", 12);
+	PutStr(1 * 8, 7 * 8, "       Tank1 Tank2", 12);
+	PutStr(1 * 8, 8 * 8, "Up:", 12);
+	PutStr(1 * 8, 9 * 8, "Down:", 12);
+	PutStr(1 * 8, 10 * 8, "Left:", 12);
+	PutStr(1 * 8, 11 * 8, "Right:", 12);
+	PutStr(1 * 8, 12 * 8, "Fire:", 12);
+
+	snprintf(str, sizeof(str), "%6s", Video_fullscreen ? "true" : "false");
+	PutStr(13 * 8, 4 * 8, str, j == 0 ? 12 : 13);
+
+	snprintf(str2, sizeof(str2), "%dx%d", Video_X, Video_Y);
+	snprintf(str, sizeof(str), "%9s", str2);
+	PutStr(10 * 8, 5 * 8, str, j == 1 ? 12 : 13);
+
+	PrintKey(8 * 8, 8 * 8, sym_pl[0].up, j == 2 ? 12 : 13);
+	PrintKey(8 * 8, 9 * 8, sym_pl[0].down, j == 3 ? 12 : 13);
+	PrintKey(8 * 8, 10 * 8, sym_pl[0].left, j == 4 ? 12 : 13);
+	PrintKey(8 * 8, 11 * 8, sym_pl[0].right, j == 5 ? 12 : 13);
+	PrintKey(8 * 8, 12 * 8, sym_pl[0].fire, j == 6 ? 12 : 13);
+
+	PrintKey(14 * 8, 8 * 8, sym_pl[1].up, j == 7 ? 12 : 13);
+	PrintKey(14 * 8, 9 * 8, sym_pl[1].down, j == 8 ? 12 : 13);
+	PrintKey(14 * 8, 10 * 8, sym_pl[1].left, j == 9 ? 12 : 13);
+	PrintKey(14 * 8, 11 * 8, sym_pl[1].right, j == 10 ? 12 : 13);
+	PrintKey(14 * 8, 12 * 8, sym_pl[1].fire, j == 11 ? 12 : 13);
+}
+
+void Settings(void) {
+	int j = 0;
+	int old;
+	int redraw = 1;
+
 	while(!key_quit) {
-		HandleEvents();
+		old = j;
 
 		if(key_menu_up)
 			j--;
@@ -301,107 +415,75 @@ void Settings(void) {
 		key_menu_left = 0;
 		key_menu_right = 0;
 
-		SDL_FillRect(screen, NULL, color[0]);
-
-		PutStr(6 * 8, 2 * 8, "Settings", color[12]);
-		PutStr(1 * 8, 4 * 8, "Fullscreen:", color[12]);
-		PutStr(1 * 8, 5 * 8, "Mode:", color[12]);
-		PutStr(1 * 8, 7 * 8, "       Tank1 Tank2", color[12]);
-		PutStr(1 * 8, 8 * 8, "Up:", color[12]);
-		PutStr(1 * 8, 9 * 8, "Down:", color[12]);
-		PutStr(1 * 8, 10 * 8, "Left:", color[12]);
-		PutStr(1 * 8, 11 * 8, "Right:", color[12]);
-		PutStr(1 * 8, 12 * 8, "Fire:", color[12]);
-
-		snprintf(str, sizeof(str), "%6s", Video_fullscreen ? "true" : "false");
-		PutStr(13 * 8, 4 * 8, str, color[j == 0 ? 12 : 13]);
-
-		snprintf(str2, sizeof(str2), "%dx%d", Video_X, Video_Y);
-		snprintf(str, sizeof(str), "%9s", str2);
-		PutStr(10 * 8, 5 * 8, str, color[j == 1 ? 12 : 13]);
-
-		PrintKey(8 * 8, 8 * 8, sym_pl[0].up, color[j == 2 ? 12 : 13]);
-		PrintKey(8 * 8, 9 * 8, sym_pl[0].down, color[j == 3 ? 12 : 13]);
-		PrintKey(8 * 8, 10 * 8, sym_pl[0].left, color[j == 4 ? 12 : 13]);
-		PrintKey(8 * 8, 11 * 8, sym_pl[0].right, color[j == 5 ? 12 : 13]);
-		PrintKey(8 * 8, 12 * 8, sym_pl[0].fire, color[j == 6 ? 12 : 13]);
-
-		PrintKey(14 * 8, 8 * 8, sym_pl[1].up, color[j == 7 ? 12 : 13]);
-		PrintKey(14 * 8, 9 * 8, sym_pl[1].down, color[j == 8 ? 12 : 13]);
-		PrintKey(14 * 8, 10 * 8, sym_pl[1].left, color[j == 9 ? 12 : 13]);
-		PrintKey(14 * 8, 11 * 8, sym_pl[1].right, color[j == 10 ? 12 : 13]);
-		PrintKey(14 * 8, 12 * 8, sym_pl[1].fire, color[j == 11 ? 12 : 13]);
+		if(j != old) redraw = 1;
+
+		if(redraw) {
+			Draw_Settings(j);
+			Present();
+			redraw = 0;
+		}
 
 		if(key_menu_enter) {
 			if(j == 0) {
 				Video_fullscreen = !Video_fullscreen;
 			} else if(j == 2) {
-				PrintKey(8 * 8, 8 * 8, sym_pl[0].up, color[0]);
-				PutStr(8 * 8, 8 * 8, "key", color[12]);
-				SDL_UpdateWindowSurface(window);
+				PrintKey(8 * 8, 8 * 8, sym_pl[0].up, 0);
+				PutStr(8 * 8, 8 * 8, "key", 12);
+				Present();
 
 				sym_pl[0].up = GetKeyPress();
 			} else if(j == 3) {
-				PrintKey(8 * 8, 9 * 8, sym_pl[0].down, color[0]);
-				PutStr(8 * 8, 9 * 8, str, color[0]);
-				PutStr(8 * 8, 9 * 8, "key", color[12]);
-				SDL_UpdateWindowSurface(window);
+				PrintKey(8 * 8, 9 * 8, sym_pl[0].down, 0);
+				PutStr(8 * 8, 9 * 8, "key", 12);
+				Present();
 
 				sym_pl[0].down = GetKeyPress();
 			} else if(j == 4) {
-				PrintKey(8 * 8, 10 * 8, sym_pl[0].left, color[0]);
-				PutStr(8 * 8, 10 * 8, str, color[0]);
-				PutStr(8 * 8, 10 * 8, "key", color[12]);
-				SDL_UpdateWindowSurface(window);
+				PrintKey(8 * 8, 10 * 8, sym_pl[0].left, 0);
+				PutStr(8 * 8, 10 * 8, "key", 12);
+				Present();
 
 				sym_pl[0].left = GetKeyPress();
 			} else if(j == 5) {
-				PrintKey(8 * 8, 11 * 8, sym_pl[0].right, color[0]);
-				PutStr(8 * 8, 11 * 8, str, color[0]);
-				PutStr(8 * 8, 11 * 8, "key", color[12]);
-				SDL_UpdateWindowSurface(window);
+				PrintKey(8 * 8, 11 * 8, sym_pl[0].right, 0);
+				PutStr(8 * 8, 11 * 8, "key", 12);
+				Present();
 
 				sym_pl[0].right = GetKeyPress();
 			} else if(j == 6) {
-				PrintKey(8 * 8, 12 * 8, sym_pl[0].fire, color[0]);
-				PutStr(8 * 8, 12 * 8, str, color[0]);
-				PutStr(8 * 8, 12 * 8, "key", color[12]);
-				SDL_UpdateWindowSurface(window);
+				PrintKey(8 * 8, 12 * 8, sym_pl[0].fire, 0);
+				PutStr(8 * 8, 12 * 8, "key", 12);
+				Present();
 
 				sym_pl[0].fire = GetKeyPress();
 			} else if(j == 7) {
-				PrintKey(14 * 8, 8 * 8, sym_pl[1].up, color[0]);
-				PutStr(14 * 8, 8 * 8, str, color[0]);
-				PutStr(14 * 8, 8 * 8, "key", color[12]);
-				SDL_UpdateWindowSurface(window);
+				PrintKey(14 * 8, 8 * 8, sym_pl[1].up, 0);
+				PutStr(14 * 8, 8 * 8, "key", 12);
+				Present();
 
 				sym_pl[1].up = GetKeyPress();
 			} else if(j == 8) {
-				PrintKey(14 * 8, 9 * 8, sym_pl[1].down, color[0]);
-				PutStr(14 * 8, 9 * 8, str, color[0]);
-				PutStr(14 * 8, 9 * 8, "key", color[12]);
-				SDL_UpdateWindowSurface(window);
+				PrintKey(14 * 8, 9 * 8, sym_pl[1].down, 0);
+				PutStr(14 * 8, 9 * 8, "key", 12);
+				Present();
 
 				sym_pl[1].down = GetKeyPress();
 			} else if(j == 9) {
-				PrintKey(14 * 8, 10 * 8, sym_pl[1].left, color[0]);
-				PutStr(14 * 8, 10 * 8, str, color[0]);
-				PutStr(14 * 8, 10 * 8, "key", color[12]);
-				SDL_UpdateWindowSurface(window);
+				PrintKey(14 * 8, 10 * 8, sym_pl[1].left, 0);
+				PutStr(14 * 8, 10 * 8, "key", 12);
+				Present();
 
 				sym_pl[1].left = GetKeyPress();
 			} else if(j == 10) {
-				PrintKey(14 * 8, 11 * 8, sym_pl[1].right, color[0]);
-				PutStr(14 * 8, 11 * 8, str, color[0]);
-				PutStr(14 * 8, 11 * 8, "key", color[12]);
-				SDL_UpdateWindowSurface(window);
+				PrintKey(14 * 8, 11 * 8, sym_pl[1].right, 0);
+				PutStr(14 * 8, 11 * 8, "key", 12);
+				Present();
 
 				sym_pl[1].right = GetKeyPress();
 			} else if(j == 11) {
-				PrintKey(14 * 8, 12 * 8, sym_pl[1].fire, color[0]);
-				PutStr(14 * 8, 12 * 8, str, color[0]);
-				PutStr(14 * 8, 12 * 8, "key", color[12]);
-				SDL_UpdateWindowSurface(window);
+				PrintKey(14 * 8, 12 * 8, sym_pl[1].fire, 0);
+				PutStr(14 * 8, 12 * 8, "key", 12);
+				Present();
 
 				sym_pl[1].fire = GetKeyPress();
 			}
@@ -411,10 +493,11 @@ void Settings(void) {
 			}
 
 			key_menu_enter = 0;
+			redraw = 1;
+			continue;
 		}
 
-		SDL_UpdateWindowSurface(window);
-		SDL_Delay(10);
+		redraw = WaitEvents();
 	}
 
 	key_quit = 0;
@@ -423,150 +506,133 @@ void Settings(void) {
 void Information(void) {
 	char str[22];
 
-	SDL_FillRect(screen, NULL, color[0]);
+	FillScreen(0);
 	snprintf(str, 21, "SDL Tunneler was");
-	PutStr(8, 8, str, color[12]);
+	PutStr(8, 8, str, 12);
 	snprintf(str, 21, "made by Taneli");
-	PutStr(8, 16, str, color[12]);
+	PutStr(8, 16, str, 12);
 	snprintf(str, 21, "Kalvas in 2003. ");
-	PutStr(8, 24, str, color[12]);
+	PutStr(8, 24, str, 12);
 
 	snprintf(str, 21, "The original DOS");
-	PutStr(8, 40, str, color[12]);
+	PutStr(8, 40, str, 12);
 	snprintf(str, 21, "Tunneler was made");
-	PutStr(8, 48, str, color[12]);
+	PutStr(8, 48, str, 12);
 	snprintf(str, 21, "by Geoffrey");
-	PutStr(8, 56, str, color[12]);
+	PutStr(8, 56, str, 12);
 	snprintf(str, 21, "Silverton in 1991.");
-	PutStr(8, 64, str, color[12]);
+	PutStr(8, 64, str, 12);
 
 	snprintf(str, 21, "This game is free");
-	PutStr(8, 80, str, color[12]);
+	PutStr(8, 80, str, 12);
 	snprintf(str, 21, "software. Happy");
-	PutStr(8, 88, str, color[12]);
+	PutStr(8, 88, str, 12);
 	snprintf(str, 21, "Tunneling!");
-	PutStr(8, 96, str, color[12]);
-
-	key_menu_enter = 0;
-	key_quit = 0;
-
-	SDL_UpdateWindowSurface(window);
-	SDL_Delay(10);
+	PutStr(8, 96, str, 12);
 
-	while(!key_quit) {
-		HandleEvents();
-
-		if(key_menu_enter) {
-			key_menu_enter = 0;
-			break;
-		}
-
-		SDL_Delay(10);
-	}
-
-	key_quit = 0;
+	Present();
+	WaitEnter(Present);
 }
 
-void Print_Stats(void) {
+void Print_Stats(const struct WORLD *w) {
 	char str[22];
 
-	SDL_FillRect(screen, NULL, color[0]);
+	FillScreen(0);
 
 	snprintf(str, 21, "Victories:");
-	PutStr(25, 20, str, color[12]);
+	PutStr(25, 20, str, 12);
 
-	snprintf(str, 21, "Tank 1: %d", Tank[1].deaths);
-	PutStr(25, 35, str, color[30]);
+	snprintf(str, 21, "Tank 1: %d", w->tank[1].deaths);
+	PutStr(25, 35, str, 30);
 
-	snprintf(str, 21, "Tank 2: %d", Tank[0].deaths);
-	PutStr(25, 43, str, color[40]);
+	snprintf(str, 21, "Tank 2: %d", w->tank[0].deaths);
+	PutStr(25, 43, str, 40);
 
-	key_menu_enter = 0;
-	key_quit = 0;
-
-	SDL_UpdateWindowSurface(window);
-	SDL_Delay(10);
-
-	while(!key_quit) {
-		HandleEvents();
-
-		if(key_menu_enter) {
-			key_menu_enter = 0;
-			break;
-		}
-
-		SDL_Delay(10);
-	}
-
-	key_quit = 0;
+	Present();
+	WaitEnter(Present);
 }
 
-void Print_Field(void) {
+void Print_Field(const struct WORLD *w) {
 	int x, y;
 	int i, j;
 
-	key_menu_enter = 0;
-
 	SDL_FillRect(screen, NULL, color[0]);
 	SDL_LockSurface(screen);
 
 	for(j = 0; j < Video_Y; j++) {
 		for(i = 0; i < Video_X; i++) {
-			x = i * FIELD_SIZEX / Video_X;
-			y = j * FIELD_SIZEY / Video_Y;
+			x = (int)((Sint64)i * w->sizex / Video_X);
+			y = (int)((Sint64)j * w->sizey / Video_Y);
 
-			if(x < 50 || x > FIELD_SIZEX - 50 || y < 50 || y > FIELD_SIZEY - 50)
+			/* Chunks nobody has been near are shown as rock */
+			if(x < 50 || x > w->sizex - 50 || y < 50 || y > w->sizey - 50 || !w->ready[CHUNK_AT(w, y, x)])
 				PutPhysPixel(i, j, color[2]);
 			else
-				PutPhysPixel(i, j, color[field[y][x]]);
+				PutPhysPixel(i, j, color[FIELD(w, y, x)]);
 		}
 	}
 
 	SDL_UnlockSurface(screen);
-	SDL_UpdateWindowSurface(window);
-	SDL_Delay(10);
-
-	while(!key_quit) {
-		HandleEvents();
-
-		if(key_menu_enter) {
-			key_menu_enter = 0;
-			break;
-		}
-
-		SDL_Delay(10);
-	}
-
-	key_quit = 0;
+	PresentPhys();
+	WaitEnter(PresentPhys);
 }
 
-void Main_Game(void) {
-	double dt;
+void Main_Game(struct WORLD *w, Uint64 seed) {
+	Uint64 acc = 0;
 
-	SDL_FillRect(screen, NULL, color[0]);
-	DrawFrames();
-	SDL_UpdateWindowSurface(window);
-	DrawFrames();
+	if(Debug) printf("Seed: %llu\n", (unsigned long long)seed);
 
-	Init_Field();
-	Init_Tanks();
+	FillScreen(0);
+	DrawFrames();
+	Present();
+
+	Seed_World(w, seed);
+	if(map_file == NULL) {
+		Init_Field(w);
+		if(Debug) printf("Field set up in %.1f ms\n", (double)w->field_ns / NS_PER_MS);
+	} else {
+		if(!Load_Map(w, map_file)) exit(1);
+		if(Debug) printf("Field loaded in %.3f ms\n", (double)w->field_ns / NS_PER_MS);
+	}
+	Init_Tanks(w);
+	Init_AI(w);
 	Init_Timer();
+	Init_Limiter();
 
 	while(!key_quit) {
-		dt = Timer();
-		HandleEvents();
-		HandleActions(dt);
+		acc += Timer();
+		if(acc > MAX_FRAME_NS) acc = MAX_FRAME_NS;
+
+		HandleEvents(w);
 
-		Draw();
-		SDL_UpdateWindowSurface(window);
+		/* Run simulation at fixed rate, independent of frame rate */
+		while(acc >= TICK_NS) {
+			HandleActions(w);
+			acc -= TICK_NS;
+		}
+
+		Draw(w, (double)acc / TICK_NS);
+		Present();
+		Limit_Frame();
 	}
 
+	if(Debug) printf("Chunks made in %.1f ms\n", (double)w->chunk_ns / NS_PER_MS);
 	key_quit = 0;
 }
 
 int main(int argc, char *argv[]) {
-	int j;
+	int j, old;
+	int redraw;
 	int i = 1;
+	int headless = 0;
+	Uint64 max_ticks = 0;
+	int max_deaths = 0;
+	Uint64 seed = 0;
+	int seeded = 0;
+	int max_ammo = MAX_AMMO;
+	int max_expl = MAX_EXPL;
+	int sizex = FIELD_SIZEX;
+	int sizey = FIELD_SIZEY;
 
 	// Suppress compiler warning about unused argument
 	((void)argc);
@@ -608,8 +674,132 @@ int main(int argc, char *argv[]) {
 				printf("Argument to -ai must be 0 or 1.\n");
 				exit(1);
 			}
-			Tank[j].mode = TANK_AI;
-			Init_AI();
+			world.tank[j].mode = TANK_AI;
+		} else if(!strcmp(argv[i], "-renderer") || !strcmp(argv[i], "--renderer")) {
+			i++;
+			if(argv[i] == NULL) {
+				printf("--renderer needs an argument\n");
+				exit(1);
+			}
+			if(!strcmp(argv[i], "surface"))
+				Video_backend = VIDEO_SURFACE;
+			else if(!strcmp(argv[i], "renderer"))
+				Video_backend = VIDEO_RENDERER;
+			else if(!strcmp(argv[i], "software"))
+				Video_backend = VIDEO_SOFTWARE;
+			else {
+				printf("Argument to --renderer must be surface, renderer or software.\n");
+				exit(1);
+			}
+		} else if(!strcmp(argv[i], "-vsync")) {
+			i++;
+			if(argv[i] == NULL) {
+				printf("-vsync needs a numerical argument\n");
+				exit(1);
+			}
+			Video_vsync = atoi(argv[i]);
+		} else if(!strcmp(argv[i], "-fps")) {
+			i++;
+			if(argv[i] == NULL) {
+				printf("-fps needs a numerical argument\n");
+				exit(1);
+			}
+			Frame_rate = atoi(argv[i]);
+			if(Frame_rate < 0) {
+				printf("Frame rate can not be negative\n");
+				exit(1);
+			}
+		} else if(!strcmp(argv[i], "-benchmark") || !strcmp(argv[i], "--benchmark")) {
+			Frame_rate = 0;
+			Video_vsync = 0;
+			Debug = 1;
+		} else if(!strcmp(argv[i], "-headless") || !strcmp(argv[i], "--headless")) {
+			headless = 1;
+		} else if(!strcmp(argv[i], "-seed") || !strcmp(argv[i], "--seed")) {
+			i++;
+			if(argv[i] == NULL) {
+				printf("--seed needs a numerical argument\n");
+				exit(1);
+			}
+			seed = strtoull(argv[i], NULL, 10);
+			seeded = 1;
+		} else if(!strcmp(argv[i], "-ticks")) {
+			i++;
+			if(argv[i] == NULL) {
+				printf("-ticks needs a numerical argument\n");
+				exit(1);
+			}
+			max_ticks = strtoull(argv[i], NULL, 10);
+		} else if(!strcmp(argv[i], "-deaths")) {
+			i++;
+			if(argv[i] == NULL) {
+				printf("-deaths needs a numerical argument\n");
+				exit(1);
+			}
+			max_deaths = atoi(argv[i]);
+			if(max_deaths < 0) {
+				printf("Death count can not be negative\n");
+				exit(1);
+			}
+		} else if(!strcmp(argv[i], "-ammo")) {
+			i++;
+			if(argv[i] == NULL) {
+				printf("-ammo needs a numerical argument\n");
+				exit(1);
+			}
+			max_ammo = atoi(argv[i]);
+			if(max_ammo < 1) {
+				printf("Ammo count must be positive\n");
+				exit(1);
+			}
+		} else if(!strcmp(argv[i], "-particles")) {
+			i++;
+			if(argv[i] == NULL) {
+				printf("-particles needs a numerical argument\n");
+				exit(1);
+			}
+			max_expl = atoi(argv[i]);
+			if(max_expl < 1) {
+				printf("Particle count must be positive\n");
+				exit(1);
+			}
+		} else if(!strcmp(argv[i], "-map")) {
+			i++;
+			if(argv[i] == NULL) {
+				printf("-map needs an argument\n");
+				exit(1);
+			}
+			if(!Parse_Field_Size(argv[i], &sizex, &sizey)) {
+				printf("Map size must be WxH, from %dx%d to %dx%d\n", FIELD_MINX, FIELD_MINY, FIELD_MAX, FIELD_MAX);
+				exit(1);
+			}
+		} else if(!strcmp(argv[i], "-fieldthreads")) {
+			i++;
+			if(argv[i] == NULL) {
+				printf("-fieldthreads needs a numerical argument\n");
+				exit(1);
+			}
+			Field_threads = atoi(argv[i]);
+			if(Field_threads < 0) {
+				printf("Thread count can not be negative\n");
+				exit(1);
+			}
+		} else if(!strcmp(argv[i], "-loadmap")) {
+			i++;
+			if(argv[i] == NULL) {
+				printf("-loadmap needs a file name\n");
+				exit(1);
+			}
+			map_file = argv[i];
+		} else if(!strcmp(argv[i], "-savemap")) {
+			i++;
+			if(argv[i] == NULL) {
+				printf("-savemap needs a file name\n");
+				exit(1);
+			}
+			save_file = argv[i];
+		} else if(!strcmp(argv[i], "-debug") || !strcmp(argv[i], "--debug")) {
+			Debug = 1;
 		} else if(!strcmp(argv[i], "-version") || !strcmp(argv[i], "--version")) {
 			printf("SDL Tunneler v." VERSION "\n");
 			exit(1);
@@ -624,6 +814,22 @@ int main(int argc, char *argv[]) {
 			printf("  -h height      set height of screen\n");
 			printf("  -ai [0,1]      set tank as AI player (under development)\n");
 			printf("  --fullscreen   use fullscreen videomode\n");
+			printf("  --renderer [surface,renderer,software]\n");
+			printf("                 select presentation backend\n");
+			printf("  -vsync [0,1]   sync renderer presentation to display\n");
+			printf("  -fps rate      limit frame rate, 0 for uncapped\n");
+			printf("  --benchmark    uncapped frame rate without vsync, print statistics\n");
+			printf("  --headless     simulate AI against AI without video, print results\n");
+			printf("  --seed n       play every match from seed n\n");
+			printf("  -ticks n       stop headless match after n ticks (%d per second)\n", TICK_RATE);
+			printf("  -deaths n      stop headless match when a tank has died n times\n");
+			printf("  -ammo n        allow n shots in flight per tank (default: %d)\n", MAX_AMMO);
+			printf("  -particles n   allow n explosion particles (default: %d)\n", MAX_EXPL);
+			printf("  -map WxH       play on a W by H field (default: %dx%d)\n", FIELD_SIZEX, FIELD_SIZEY);
+			printf("  -fieldthreads n  generate whole fields for -savemap on n threads (default: CPU count)\n");
+			printf("  -loadmap file  play on the map in file\n");
+			printf("  -savemap file  save the field of --seed in file and quit\n");
+			printf("  --debug        print debug statistics\n");
 			printf("  --version      display version\n");
 			return (0);
 		}
@@ -631,13 +837,44 @@ int main(int argc, char *argv[]) {
 		i++;
 	}
 
-	srand(time(NULL));
+	if(!seeded) seed = (Uint64)time(NULL);
+	Init_Clock();
+	Init_Particles();
+	Init_Terrain();
+	Init_Footprints();
+	Init_World(&world, max_ammo, max_expl, sizex, sizey);
+
+	/* Check the map before anything else, it sets the field size */
+	if(map_file != NULL && !Load_Map(&world, map_file)) exit(1);
+
+	if(save_file != NULL) {
+		if(map_file == NULL) {
+			Seed_World(&world, seed);
+			Init_Field(&world);
+		}
+		if(!Save_Map(&world, save_file)) exit(1);
+		printf("Map %dx%d of seed %llu saved in %s\n", world.sizex, world.sizey, (unsigned long long)seed, save_file);
+		return (0);
+	}
+
+	if(headless) {
+		/* Default to an hour of play */
+		if(max_ticks == 0 && max_deaths == 0) max_ticks = 3600 * TICK_RATE;
+
+		Headless(&world, map_file, seed, max_ticks, max_deaths);
+		return (0);
+	}
+
+	printf("Map %dx%d, %.1f MiB reserved\n", world.sizex, world.sizey, (double)world.map_bytes / (1 << 20));
+
 	Init_Video();
 	Init_Font();
+	Init_Sprites();
 
 	/* Menu */
 	while(!key_quit) {
 		j = 0;
+		redraw = 1;
 		key_menu_up = 0;
 		key_menu_down = 0;
 		key_menu_left = 0;
@@ -645,7 +882,7 @@ int main(int argc, char *argv[]) {
 		key_menu_enter = 0;
 
 		while(!key_quit) {
-			HandleEvents();
+			old = j;
 
 			if(key_menu_up)
 				j--;
@@ -660,21 +897,27 @@ int main(int argc, char *argv[]) {
 			key_menu_up = 0;
 			key_menu_down = 0;
 
-			SDL_FillRect(screen, NULL, color[0]);
-			PutStr(67, 11, "SDL2", color[12]);
-			PutStr(18, 20, "Tunneler v." VERSION, color[12]);
-			PutStr(50, 55, "Start Game", color[j == 0 ? 12 : 13]);
-			PutStr(50, 65, "Settings", color[j == 1 ? 12 : 13]);
-			PutStr(50, 75, "Information", color[j == 2 ? 12 : 13]);
-			PutStr(50, 85, "Quit", color[j == 3 ? 12 : 13]);
+			if(j != old) redraw = 1;
+
+			if(redraw) {
+				FillScreen(0);
+				PutStr(67, 11, "SDL2", 12);
+				PutStr(18, 20, "Tunneler v." VERSION, 12);
+				PutStr(50, 55, "Start Game", j == 0 ? 12 : 13);
+				PutStr(50, 65, "Settings", j == 1 ? 12 : 13);
+				PutStr(50, 75, "Information", j == 2 ? 12 : 13);
+				PutStr(50, 85, "Quit", j == 3 ? 12 : 13);
+				Present();
+				redraw = 0;
+			}
 
 			if(key_menu_enter) {
 				key_menu_enter = 0;
 
 				if(j == 0) {
-					Main_Game();
-					Print_Field();
-					Print_Stats();
+					Main_Game(&world, seeded ? seed : (Uint64)time(NULL));
+					Print_Field(&world);
+					Print_Stats(&world);
 				} else if(j == 1) {
 					Settings();
 					Write_Config();
@@ -687,8 +930,7 @@ int main(int argc, char *argv[]) {
 				break;
 			}
 
-			SDL_UpdateWindowSurface(window);
-			SDL_Delay(10);
+			redraw = WaitEvents();
 		}
 	}
 
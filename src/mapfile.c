@@ -0,0 +1,394 @@
+/* mapfile.c
+ * Map files
+ * Last modified 17 Oct 2026
+ *
+ * Copyright (c) 2004,2007 Taneli Kalvas
+ *
+ * This file is part of SDL Tunneler
+ *
+ * SDL Tunneler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SDL Tunneler is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SDL Tunneler ; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * Questions, comments and bug reports should be sent to the author
+ * directly via email at tvkalvas@cc.jyu.fi
+ */
+
+#include "mapfile.h"
+#include "game.h"
+#include "terrain.h"
+#include "timer.h"
+#include "types.h"
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*  Map file format, numbers are little endian
+ *
+ *  Offset  Size  Contents
+ *  0       6     "TUNMAP"
+ *  6       2     Version, 1
+ *  8       8     Width and height as Uint32
+ *  16      16    Base x and y of tank 1, then of tank 2
+ *  32      4     Bytes of terrain data
+ *  36      4     Zero
+ *  40      8     Hash of terrain data, see Hash_Word()
+ *  48            Terrain data
+ *
+ *  Terrain is a list of runs over the field in row order, each the cell
+ *  value and then the length as a LEB128 number. Sand (8 and 9) makes
+ *  a single run of value 8, followed by a bit per cell set for 9, eight
+ *  to a byte from the lowest bit up.
+ */
+#define MAP_MAGIC   "TUNMAP"
+#define MAP_VERSION 1
+#define MAP_HEADER  48
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME  0x100000001b3ULL
+
+/* FNV-1a over 8 byte words rather than bytes, the data is hashed as
+ * little endian words with the last one padded with zeros */
+static Uint64 Hash_Word(Uint64 hash, Uint64 a) {
+	return ((hash ^ a) * FNV_PRIME);
+}
+
+static Uint64 Get(const unsigned char *p, int bytes) {
+	Uint64 a = 0;
+	int i;
+
+	for(i = bytes - 1; i >= 0; i--) a = (a << 8) | p[i];
+
+	return (a);
+}
+
+static void Put(unsigned char *p, Uint64 a, int bytes) {
+	int i;
+
+	for(i = 0; i < bytes; i++) p[i] = (unsigned char)(a >> (8 * i));
+}
+
+/* Buffered output of terrain data, hashed on the way */
+struct OUT {
+	FILE *f;
+	Uint64 hash;
+	Uint64 word; /* Bytes not yet hashed */
+	Uint64 bytes;
+	int n;
+	unsigned char buf[65536];
+};
+
+static void Flush(struct OUT *o) {
+	if(o->n > 0) fwrite(o->buf, 1, o->n, o->f);
+	o->n = 0;
+}
+
+static void Put_Byte(struct OUT *o, unsigned char c) {
+	o->word |= (Uint64)c << (8 * (o->bytes & 7));
+	if((o->bytes & 7) == 7) {
+		o->hash = Hash_Word(o->hash, o->word);
+		o->word = 0;
+	}
+	o->bytes++;
+	o->buf[o->n++] = c;
+	if(o->n == (int)sizeof(o->buf)) Flush(o);
+}
+
+static void Put_Varint(struct OUT *o, size_t a) {
+	while(a >= 0x80) {
+		Put_Byte(o, (unsigned char)(a | 0x80));
+		a >>= 7;
+	}
+	Put_Byte(o, (unsigned char)a);
+}
+
+/* Position in the field, stepping through it in row order */
+struct CURSOR {
+	int y, x;
+};
+
+static void Advance(const struct WORLD *w, struct CURSOR *c) {
+	if(++c->x == w->sizex) {
+		c->x = 0;
+		c->y++;
+	}
+}
+
+/* Cell under c, as saved */
+static unsigned char Map_Cell(const struct WORLD *w, const struct CURSOR *c) {
+	unsigned char v = FIELD(w, c->y, c->x);
+
+	return (v == 9 ? 8 : v);
+}
+
+/* Save the field of w to path, generating any chunks not yet made.
+ * Returns 0 and prints why on failure. */
+int Save_Map(struct WORLD *w, const char *path) {
+	size_t n = (size_t)w->sizex * w->sizey;
+	size_t i, j, k;
+	struct CURSOR run, at;
+	unsigned char head[MAP_HEADER];
+	unsigned char v, bits;
+	struct OUT *o;
+
+	Generate_All(w);
+
+	o = malloc(sizeof(struct OUT));
+	if(o == NULL) {
+		printf("Out of memory\n");
+		exit(1);
+	}
+
+	o->f = fopen(path, "wb");
+	if(o->f == NULL) {
+		printf("Unable to write map file %s\n", path);
+		free(o);
+		return (0);
+	}
+	o->hash = FNV_OFFSET;
+	o->word = 0;
+	o->bytes = 0;
+	o->n = 0;
+
+	/* Header is written again once the data is known */
+	memset(head, 0, MAP_HEADER);
+	fwrite(head, 1, MAP_HEADER, o->f);
+
+	run.y = 0;
+	run.x = 0;
+	at = run;
+	for(i = 0; i < n; i = j) {
+		v = Map_Cell(w, &run);
+		for(j = i + 1, Advance(w, &at); j < n && Map_Cell(w, &at) == v; j++) Advance(w, &at);
+
+		Put_Byte(o, v);
+		Put_Varint(o, j - i);
+
+		if(v == 8) {
+			bits = 0;
+			for(k = i; k < j; k++, Advance(w, &run)) {
+				bits |= (FIELD(w, run.y, run.x) & 1) << ((k - i) & 7);
+				if(((k - i) & 7) == 7 || k == j - 1) {
+					Put_Byte(o, bits);
+					bits = 0;
+				}
+			}
+		}
+		run = at;
+	}
+	Flush(o);
+	if(o->bytes & 7) o->hash = Hash_Word(o->hash, o->word);
+
+	memcpy(head, MAP_MAGIC, 6);
+	Put(head + 6, MAP_VERSION, 2);
+	Put(head + 8, w->sizex, 4);
+	Put(head + 12, w->sizey, 4);
+	Put(head + 16, w->tank[0].basex, 4);
+	Put(head + 20, w->tank[0].basey, 4);
+	Put(head + 24, w->tank[1].basex, 4);
+	Put(head + 28, w->tank[1].basey, 4);
+	Put(head + 32, o->bytes, 4);
+	Put(head + 40, o->hash, 8);
+
+	fseek(o->f, 0, SEEK_SET);
+	fwrite(head, 1, MAP_HEADER, o->f);
+
+	if(ferror(o->f) || fclose(o->f) != 0 || o->bytes > 0xffffffffULL) {
+		printf("Unable to write map file %s\n", path);
+		free(o);
+		return (0);
+	}
+
+	free(o);
+	return (1);
+}
+
+static int Get_Varint(const unsigned char **p, const unsigned char *end, size_t *a) {
+	int shift;
+
+	*a = 0;
+	for(shift = 0; *p < end && shift < 35; shift += 7) {
+		*a |= (size_t)(**p & 0x7f) << shift;
+		if(!(*(*p)++ & 0x80)) return (1);
+	}
+
+	return (0);
+}
+
+/* Is the outermost 50 cells of the field rock or wall, so that tanks
+ * and their views stay inside. Needs the bit planes. */
+static int Border_Solid(const struct WORLD *w) {
+	const Uint64 side = ((Uint64)1 << 50) - 1;
+	int i, j;
+
+	for(i = 0; i < w->sizey; i++) {
+		if(i < 50 || i >= w->sizey - 50) {
+			for(j = 0; j + 64 <= w->sizex; j += 64)
+				if(~Plane_Bits(w, w->solid, i, j)) return (0);
+			if(j < w->sizex && (~Plane_Bits(w, w->solid, i, j) & (((Uint64)1 << (w->sizex - j)) - 1))) return (0);
+		} else {
+			if((Plane_Bits(w, w->solid, i, 0) & side) != side) return (0);
+			if((Plane_Bits(w, w->solid, i, w->sizex - 50) & side) != side) return (0);
+		}
+	}
+
+	return (1);
+}
+
+/* Read map data d of size bytes into w. Returns what is wrong with the
+ * data or NULL. */
+static const char *Decode_Map(struct WORLD *w, const unsigned char *d, size_t size) {
+	const unsigned char *p, *end;
+	Uint64 sizex, sizey, bytes, hash;
+	Uint64 base[4];
+	size_t n, pos, len, done, k;
+	struct CURSOR at;
+	unsigned char v;
+	int i;
+
+	if(size < MAP_HEADER || memcmp(d, MAP_MAGIC, 6) != 0) return ("not a map file");
+	if(Get(d + 6, 2) != MAP_VERSION) return ("unknown version");
+
+	sizex = Get(d + 8, 4);
+	sizey = Get(d + 12, 4);
+	if(sizex < FIELD_MINX || sizex > FIELD_MAX || sizey < FIELD_MINY || sizey > FIELD_MAX) return ("bad size");
+
+	for(i = 0; i < 4; i++) base[i] = Get(d + 16 + 4 * i, 4);
+	for(i = 0; i < 2; i++) {
+		if(base[2 * i] < 50 + BASE_SIZEX || base[2 * i] > sizex - 50 - BASE_SIZEX) return ("base outside field");
+		if(base[2 * i + 1] < 50 + BASE_SIZEY || base[2 * i + 1] > sizey - 50 - BASE_SIZEY) return ("base outside field");
+	}
+
+	bytes = Get(d + 32, 4);
+	if(bytes != size - MAP_HEADER) return ("truncated");
+
+	/* Reject the file before touching the field if the hash does not
+	 * match */
+	hash = FNV_OFFSET;
+	for(p = d + MAP_HEADER; p + 8 <= d + size; p += 8) hash = Hash_Word(hash, Get(p, 8));
+	if(p < d + size) hash = Hash_Word(hash, Get(p, (int)(d + size - p)));
+	if(hash != Get(d + 40, 8)) return ("checksum mismatch");
+
+	if((int)sizex != w->sizex || (int)sizey != w->sizey) {
+		Free_Field(w);
+		Alloc_Field(w, (int)sizex, (int)sizey);
+	}
+
+	n = (size_t)sizex * sizey;
+	p = d + MAP_HEADER;
+	end = d + size;
+	at.y = 0;
+	at.x = 0;
+	for(pos = 0; pos < n; pos += len) {
+		if(p == end) return ("truncated terrain");
+		v = *p++;
+		if(!Get_Varint(&p, end, &len) || len == 0 || len > n - pos) return ("bad run");
+		if(v == 8 && (size_t)(end - p) < (len + 7) / 8) return ("truncated terrain");
+		if(v != 0 && v != 8 && v != 10 && v != 30 && v != 40) return ("bad cell");
+
+		/* In pieces within a row of a chunk */
+		for(done = 0; done < len; done += k) {
+			k = CHUNK - (at.x & (CHUNK - 1));
+			if(k > (size_t)(w->sizex - at.x)) k = w->sizex - at.x;
+			if(k > len - done) k = len - done;
+
+			if(v == 8)
+				Expand_Sand(&FIELD(w, at.y, at.x), p, done, k);
+			else
+				memset(&FIELD(w, at.y, at.x), v, k);
+
+			at.x += (int)k;
+			if(at.x == w->sizex) {
+				at.x = 0;
+				at.y++;
+			}
+		}
+		if(v == 8) p += (len + 7) / 8;
+	}
+	if(p != end) return ("extra data");
+
+	/* Every chunk is loaded, none is to be generated */
+	memset(w->ready, 1, (size_t)w->chunksx * w->chunksy);
+	Update_Planes(w);
+	if(!Border_Solid(w)) return ("border is not solid");
+
+	for(i = 0; i < 2; i++) {
+		w->tank[i].basex = (int)base[2 * i];
+		w->tank[i].basey = (int)base[2 * i + 1];
+	}
+
+	return (NULL);
+}
+
+/*  Load Map
+ *
+ *  Replaces the field of w with the map in path, resizing it if needed.
+ *  The file is memory mapped where possible. Returns 0 and prints why
+ *  on failure, the field is then undefined.
+ */
+int Load_Map(struct WORLD *w, const char *path) {
+	Uint64 start = Clock_Real();
+	const char *err = "unable to read";
+	unsigned char *data = NULL;
+	size_t size = 0;
+#ifndef WIN32
+	struct stat st;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if(fd >= 0) {
+		if(fstat(fd, &st) == 0 && st.st_size > 0) {
+			size = (size_t)st.st_size;
+			data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if(data == MAP_FAILED) data = NULL;
+		}
+		close(fd);
+	}
+	if(data != NULL) {
+		err = Decode_Map(w, data, size);
+		munmap(data, size);
+	}
+#else
+	FILE *f = fopen(path, "rb");
+
+	if(f != NULL) {
+		fseek(f, 0, SEEK_END);
+		size = (size_t)ftell(f);
+		fseek(f, 0, SEEK_SET);
+		data = malloc(size > 0 ? size : 1);
+		if(data != NULL && fread(data, 1, size, f) == size) err = Decode_Map(w, data, size);
+		free(data);
+		fclose(f);
+	}
+#endif
+
+	if(err != NULL) {
+		printf("Map file %s: %s\n", path, err);
+		return (0);
+	}
+
+	w->field_ns = Clock_Real() - start;
+	w->chunk_ns = 0;
+
+	return (1);
+}
+
+/* End of file mapfile.c */
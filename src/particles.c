@@ -0,0 +1,155 @@
+/* particles.c
+ * Explosion particles
+ * Last modified 17 Oct 2026
+ *
+ * Copyright (c) 2004,2007 Taneli Kalvas
+ *
+ * This file is part of SDL Tunneler
+ *
+ * SDL Tunneler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SDL Tunneler is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SDL Tunneler ; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * Questions, comments and bug reports should be sent to the author
+ * directly via email at tvkalvas@cc.jyu.fi
+ */
+
+#include "particles.h"
+#include "dda.h"
+#include "fixed.h"
+#include "game.h"
+#include "terrain.h"
+#include "types.h"
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+Sint32 part_xtable[PART_DIRS];
+Sint32 part_ytable[PART_DIRS];
+
+/* Displace particles by their velocity and age them by one tick. A
+ * plain loop the compiler vectorises by itself. */
+static void Move(struct PARTICLES *p) {
+	int i;
+
+	for(i = 0; i < p->n; i++) {
+		p->x[i] += p->vx[i];
+		p->y[i] += p->vy[i];
+		p->life[i]--;
+	}
+}
+
+/* Build the direction tables. Call once before any thread updates
+ * particles. */
+void Init_Particles(void) {
+	int i;
+
+	/* Rounded to fixed point, so that the tables are the same wherever
+	 * sin() and cos() differ in the last bits */
+	for(i = 0; i < PART_DIRS; i++) {
+		part_xtable[i] = To_Fix(cos(2.0 * M_PI * i / PART_DIRS));
+		part_ytable[i] = To_Fix(sin(2.0 * M_PI * i / PART_DIRS));
+	}
+}
+
+static Sint32 *Alloc_Ints(int n) {
+	Sint32 *a = calloc(n, sizeof(Sint32));
+
+	if(a == NULL) {
+		printf("Out of memory\n");
+		exit(1);
+	}
+
+	return (a);
+}
+
+void Alloc_Particles(struct PARTICLES *p, int max) {
+	p->x = Alloc_Ints(max);
+	p->y = Alloc_Ints(max);
+	p->vx = Alloc_Ints(max);
+	p->vy = Alloc_Ints(max);
+	p->life = Alloc_Ints(max);
+	p->n = 0;
+	p->max = max;
+}
+
+void Free_Particles(struct PARTICLES *p) {
+	free(p->x);
+	free(p->y);
+	free(p->vx);
+	free(p->vy);
+	free(p->life);
+}
+
+/* Add a particle, returns 0 if the store is full */
+int Spawn_Particle(struct PARTICLES *p, Sint32 x, Sint32 y, Sint32 vx, Sint32 vy, Sint32 life) {
+	int i;
+
+	if(p->n == p->max) return (0);
+
+	i = p->n++;
+	p->x[i] = x;
+	p->y[i] = y;
+	p->vx[i] = vx;
+	p->vy[i] = vy;
+	p->life[i] = life;
+
+	return (1);
+}
+
+/*  Update Particles
+ *
+ *  Moves particles by one tick. A particle stops and dies in the
+ *  first cell with earth, rock or a wall on its way, and digs away
+ *  earth. Dead particles are removed. The terrain test is scalar, one
+ *  lookup per cell a particle crosses.
+ */
+void Update_Particles(struct WORLD *w, struct PARTICLES *p) {
+	struct DDA d;
+	int i;
+
+	for(i = 0; i < p->n; i++) {
+		DDA_Start(&d, p->x[i], p->y[i], p->vx[i], p->vy[i]);
+		do {
+			if(!Is_Empty(w, d.y, d.x)) break;
+		} while(DDA_Step(&d));
+
+		if(Is_Diggable(w, d.y, d.x)) {
+			Dig(w, d.y, d.x);
+			p->life[i] = 0;
+		} else if(Is_Solid(w, d.y, d.x)) {
+			p->life[i] = 0;
+		}
+	}
+
+	/* Stopped particles are removed below, so moving them is harmless */
+	Move(p);
+
+	for(i = 0; i < p->n;) {
+		if(p->life[i] > 0) {
+			i++;
+			continue;
+		}
+
+		/* Move the last live particle into the free slot */
+		p->n--;
+		p->x[i] = p->x[p->n];
+		p->y[i] = p->y[p->n];
+		p->vx[i] = p->vx[p->n];
+		p->vy[i] = p->vy[p->n];
+		p->life[i] = p->life[p->n];
+	}
+}
+
+/* End of file particles.c */
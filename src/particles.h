@@ -0,0 +1,59 @@
+/* particles.h
+ * Explosion particles Header
+ * Last modified 17 Oct 2026
+ *
+ * Copyright (c) 2004,2007 Taneli Kalvas
+ *
+ * This file is part of SDL Tunneler
+ *
+ * SDL Tunneler is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * SDL Tunneler is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SDL Tunneler ; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * Questions, comments and bug reports should be sent to the author
+ * directly via email at tvkalvas@cc.jyu.fi
+ */
+
+#ifndef TUNNELER_PARTICLES_H
+#define TUNNELER_PARTICLES_H
+
+#include "game.h"
+#include <SDL2/SDL.h>
+
+/* Number of directions particles fly in */
+#define PART_DIRS 256
+
+/* Explosion particles as a structure of arrays. Live particles are
+ * packed in [0, n). Positions and velocities are 16.16 fixed point. */
+struct PARTICLES {
+	Sint32 *x, *y;
+	Sint32 *vx, *vy; /* Displacement per tick */
+	Sint32 *life;    /* Remaining lifetime in ticks */
+	int n;
+	int max;
+};
+
+struct WORLD;
+
+/* Unit vectors of particle directions, set by Init_Particles() */
+extern Sint32 part_xtable[PART_DIRS];
+extern Sint32 part_ytable[PART_DIRS];
+
+void Init_Particles(void);
+void Alloc_Particles(struct PARTICLES *p, int max);
+void Free_Particles(struct PARTICLES *p);
+int Spawn_Particle(struct PARTICLES *p, Sint32 x, Sint32 y, Sint32 vx, Sint32 vy, Sint32 life);
+void Update_Particles(struct WORLD *w, struct PARTICLES *p);
+
+#endif /* End of file particles.h */
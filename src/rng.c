@@ -0,0 +1,87 @@
+/* rng.c
+ * Seedable random number generators
+ * Last modified 17 Oct 2026
+ *
+ * Copyright (c) 2004,2007 Taneli Kalvas
+ *
+ * This file is part of SDL Tunneler
+ *
+ * SDL Tunneler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SDL Tunneler is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SDL Tunneler ; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * Questions, comments and bug reports should be sent to the author
+ * directly via email at tvkalvas@cc.jyu.fi
+ */
+
+#include "rng.h"
+#include "types.h"
+#include <SDL2/SDL.h>
+
+/* PCG32 (XSH RR variant, see pcg-random.org). 64 bits of state plus
+ * a stream selector, so generators seeded alike but with different
+ * streams give unrelated sequences. */
+#define PCG_MULT 6364136223846793005ULL
+
+void Seed_RNG(struct RNG *r, Uint64 seed, Uint64 stream) {
+	r->state = 0;
+	r->inc = (stream << 1) | 1;
+	RNG_Next(r);
+	r->state += seed;
+	RNG_Next(r);
+}
+
+Uint32 RNG_Next(struct RNG *r) {
+	Uint64 old = r->state;
+	Uint32 x, rot;
+
+	r->state = old * PCG_MULT + r->inc;
+	x = (Uint32)(((old >> 18) ^ old) >> 27);
+	rot = (Uint32)(old >> 59);
+
+	return ((x >> rot) | (x << ((-rot) & 31)));
+}
+
+/* Uniform in [0, n) */
+int RNG_Range(struct RNG *r, int n) {
+	return ((int)(((Uint64)RNG_Next(r) * (Uint32)n) >> 32));
+}
+
+/* Uniform in [0.0, 1.0) */
+double RNG_Double(struct RNG *r) {
+	return (RNG_Next(r) * (1.0 / 4294967296.0));
+}
+
+/* Counter based generator: 64 random bits for counter under key, by
+ * the SplitMix64 finaliser. Numbers can be drawn in any order and from
+ * any thread, the result depends only on key and counter. */
+Uint64 RNG_Hash(Uint64 key, Uint64 counter) {
+	Uint64 z = key + (counter + 1) * 0x9E3779B97F4A7C15ULL;
+
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+	return (z ^ (z >> 31));
+}
+
+/* Seed all generators of a world. Terrain, gameplay and cosmetic
+ * effects use separate streams, so drawing noise at a different frame
+ * rate does not change the match. */
+void Seed_World(struct WORLD *w, Uint64 seed) {
+	w->seed = seed;
+	Seed_RNG(&w->terrain_rng, seed, 1);
+	Seed_RNG(&w->game_rng, seed, 2);
+	Seed_RNG(&w->fx_rng, seed, 3);
+}
+
+/* End of file rng.c */
@@ -0,0 +1,47 @@
+/* rng.h
+ * Seedable random number generators Header
+ * Last modified 17 Oct 2026
+ *
+ * Copyright (c) 2004,2007 Taneli Kalvas
+ *
+ * This file is part of SDL Tunneler
+ *
+ * SDL Tunneler is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * SDL Tunneler is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SDL Tunneler ; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * Questions, comments and bug reports should be sent to the author
+ * directly via email at tvkalvas@cc.jyu.fi
+ */
+
+#ifndef TUNNELER_RNG_H
+#define TUNNELER_RNG_H
+
+#include <SDL2/SDL.h>
+
+struct RNG {
+	Uint64 state;
+	Uint64 inc;
+};
+
+struct WORLD;
+
+void Seed_RNG(struct RNG *r, Uint64 seed, Uint64 stream);
+Uint32 RNG_Next(struct RNG *r);
+int RNG_Range(struct RNG *r, int n);
+double RNG_Double(struct RNG *r);
+Uint64 RNG_Hash(Uint64 key, Uint64 counter);
+void Seed_World(struct WORLD *w, Uint64 seed);
+
+#endif /* End of file rng.h */
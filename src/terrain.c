@@ -27,192 +27,644 @@
 
 #include "terrain.h"
 #include "game.h"
-#include "tunneler.h"
+#include "rng.h"
+#include "timer.h"
 #include "types.h"
 #include <SDL2/SDL.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#ifndef WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#else
+#include <windows.h>
+#endif
+
+#if !defined(WIN32) && !defined(MAP_ANONYMOUS)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HAVE_AVX2_KERNELS
+#endif
+
+/* Cells between two fixed ends of a wall profile */
+#define WALL_SPAN 64
+
+/* Threads generating a whole field, 0 for one per CPU */
+int Field_threads = 0;
+
+/* Work shared by the threads of Generate_All(), a row of chunks at a
+ * time */
+struct FIELD_JOB {
+	struct WORLD *w;
+	SDL_atomic_t next;
+};
 
-typedef struct WALL Wall;
+/*  Row kernels
+ *
+ *  Sand() fills n cells with 8 or 9, one bit of RNG_Hash(key, counter)
+ *  per cell and counter advancing every 64 cells. Columns() sets cell j
+ *  to 10 where top[j] > i or bottom[j] > lim. Planes() builds the bit
+ *  plane words of n cells. The vector kernels handle whole words of 64
+ *  cells and leave the rest to the scalar ones.
+ */
+static Uint64 sand_bytes[256]; /* 8 cells of sand for each byte of bits */
 
-struct WALL {
-	int x, y;
-	struct WALL *next;
-};
+static void Sand_Word(unsigned char *row, Uint64 bits, int n) {
+	int k;
 
-unsigned char field[FIELD_SIZEY][FIELD_SIZEX];
+	for(k = 0; k < n; k++) row[k] = 8 + ((bits >> k) & 1);
+}
 
-void Init_Base(int y, int x, int n) {
-	int i, j;
+static void Sand_Scalar(unsigned char *row, Uint64 key, Uint64 counter, int n) {
+	Uint64 bits;
+	int j, k;
 
-	Tank[n].basex = x;
-	Tank[n].basey = y;
+	for(j = 0; j + 64 <= n; j += 64) {
+		bits = RNG_Hash(key, counter++);
+		for(k = 0; k < 64; k += 8) memcpy(row + j + k, &sand_bytes[(bits >> k) & 255], 8);
+	}
+	if(j < n) Sand_Word(row + j, RNG_Hash(key, counter), n - j);
+}
+
+/* Set n cells to 8 or 9 from packed bits first ... first + n - 1, bit
+ * 0 being the lowest bit of bits[0] */
+void Expand_Sand(unsigned char *cells, const unsigned char *bits, size_t first, size_t n) {
+	size_t k;
+
+	n += first;
+	for(k = first; k < n && (k & 7); k++) *cells++ = 8 + ((bits[k >> 3] >> (k & 7)) & 1);
+	for(; k + 8 <= n; k += 8, cells += 8) memcpy(cells, &sand_bytes[bits[k >> 3]], 8);
+	for(; k < n; k++) *cells++ = 8 + ((bits[k >> 3] >> (k & 7)) & 1);
+}
+
+static void Columns_Scalar(unsigned char *row, const int *top, const int *bottom, int i, int lim, int n) {
+	int j;
 
-	for(i = -BASE_SIZEX; i < BASE_SIZEX; i++)
-		for(j = -BASE_SIZEY; j < BASE_SIZEY; j++) field[j + y][i + x] = 0;
+	for(j = 0; j < n; j++)
+		if(top[j] > i || bottom[j] > lim) row[j] = 10;
+}
 
-	for(i = -BASE_SIZEY; i < BASE_SIZEY; i++) {
-		field[i + y][-BASE_SIZEX + x] = 30 + 10 * n;
-		field[i + y][BASE_SIZEX - 1 + x] = 30 + 10 * n;
+static void Planes_Word(const unsigned char *row, Uint64 *dig, Uint64 *solid, int n) {
+	Uint64 d = 0, s = 0;
+	int k;
+
+	for(k = 0; k < n; k++) {
+		if(row[k] == 8 || row[k] == 9)
+			d |= (Uint64)1 << k;
+		else if(row[k] >= 10)
+			s |= (Uint64)1 << k;
+	}
+
+	*dig = d;
+	*solid = s;
+}
+
+static void Planes_Scalar(const unsigned char *row, Uint64 *dig, Uint64 *solid, int n) {
+	int j;
+
+	for(j = 0; j < n; j += 64) Planes_Word(row + j, &dig[j >> 6], &solid[j >> 6], n - j < 64 ? n - j : 64);
+}
+
+#if defined(__SSE2__)
+static void Sand_SSE2(unsigned char *row, Uint64 key, Uint64 counter, int n) {
+	const __m128i bit = _mm_set1_epi64x((Sint64)0x8040201008040201ULL);
+	const __m128i eight = _mm_set1_epi8(8);
+	__m128i v;
+	Uint64 bits;
+	int j, k;
+
+	for(j = 0; j + 64 <= n; j += 64) {
+		bits = RNG_Hash(key, counter++);
+		for(k = 0; k < 64; k += 16) {
+			/* Each byte of bits over 8 bytes, test a bit in each */
+			v = _mm_set_epi64x(
+				(Sint64)(((bits >> (k + 8)) & 255) * 0x0101010101010101ULL),
+				(Sint64)(((bits >> k) & 255) * 0x0101010101010101ULL)
+			);
+			v = _mm_cmpeq_epi8(_mm_and_si128(v, bit), bit);
+			_mm_storeu_si128((__m128i *)(row + j + k), _mm_sub_epi8(eight, v));
+		}
 	}
+	if(j < n) Sand_Word(row + j, RNG_Hash(key, counter), n - j);
+}
+
+static void Columns_SSE2(unsigned char *row, const int *top, const int *bottom, int i, int lim, int n) {
+	const __m128i vi = _mm_set1_epi32(i);
+	const __m128i vlim = _mm_set1_epi32(lim);
+	const __m128i ten = _mm_set1_epi8(10);
+	__m128i m[4], v;
+	int j, k;
+
+	for(j = 0; j + 16 <= n; j += 16) {
+		for(k = 0; k < 4; k++) {
+			m[k] = _mm_or_si128(
+				_mm_cmpgt_epi32(_mm_loadu_si128((const __m128i *)(top + j + 4 * k)), vi),
+				_mm_cmpgt_epi32(_mm_loadu_si128((const __m128i *)(bottom + j + 4 * k)), vlim)
+			);
+		}
+		m[0] = _mm_packs_epi16(_mm_packs_epi32(m[0], m[1]), _mm_packs_epi32(m[2], m[3]));
 
-	for(j = -BASE_SIZEX; j <= -BASE_DOORSIZE; j++) {
-		field[-BASE_SIZEY + y][j + x] = 30 + 10 * n;
-		field[BASE_SIZEY - 1 + y][j + x] = 30 + 10 * n;
+		v = _mm_loadu_si128((const __m128i *)(row + j));
+		v = _mm_or_si128(_mm_andnot_si128(m[0], v), _mm_and_si128(m[0], ten));
+		_mm_storeu_si128((__m128i *)(row + j), v);
+	}
+	Columns_Scalar(row + j, top + j, bottom + j, i, lim, n - j);
+}
+
+static void Planes_SSE2(const unsigned char *row, Uint64 *dig, Uint64 *solid, int n) {
+	const __m128i one = _mm_set1_epi8(1);
+	const __m128i nine = _mm_set1_epi8(9);
+	const __m128i ten = _mm_set1_epi8(10);
+	__m128i v;
+	Uint64 d, s;
+	int j, k;
+
+	for(j = 0; j + 64 <= n; j += 64) {
+		d = 0;
+		s = 0;
+		for(k = 0; k < 64; k += 16) {
+			v = _mm_loadu_si128((const __m128i *)(row + j + k));
+			/* 8 or 9, and 10 or more */
+			d |= (Uint64)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_or_si128(v, one), nine)) << k;
+			s |= (Uint64)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, ten), v)) << k;
+		}
+		dig[j >> 6] = d;
+		solid[j >> 6] = s;
+	}
+	if(j < n) Planes_Word(row + j, &dig[j >> 6], &solid[j >> 6], n - j);
+}
+#endif
+
+#if defined(HAVE_AVX2_KERNELS)
+__attribute__((target("avx2"))) static void Sand_AVX2(unsigned char *row, Uint64 key, Uint64 counter, int n) {
+	const __m256i spread = _mm256_setr_epi8(
+		0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3
+	);
+	const __m256i bit = _mm256_set1_epi64x((Sint64)0x8040201008040201ULL);
+	const __m256i eight = _mm256_set1_epi8(8);
+	__m256i v;
+	Uint64 bits;
+	int j, k;
+
+	for(j = 0; j + 64 <= n; j += 64) {
+		bits = RNG_Hash(key, counter++);
+		for(k = 0; k < 64; k += 32) {
+			/* Each byte of 32 bits over 8 bytes, test a bit in each */
+			v = _mm256_shuffle_epi8(_mm256_set1_epi32((int)(Uint32)(bits >> k)), spread);
+			v = _mm256_cmpeq_epi8(_mm256_and_si256(v, bit), bit);
+			_mm256_storeu_si256((__m256i *)(row + j + k), _mm256_sub_epi8(eight, v));
+		}
+	}
+	if(j < n) Sand_Word(row + j, RNG_Hash(key, counter), n - j);
+}
+
+__attribute__((target("avx2"))) static void Columns_AVX2(unsigned char *row, const int *top, const int *bottom, int i, int lim, int n) {
+	const __m256i vi = _mm256_set1_epi32(i);
+	const __m256i vlim = _mm256_set1_epi32(lim);
+	const __m256i ten = _mm256_set1_epi8(10);
+	const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+	__m256i m[4], v;
+	int j, k;
+
+	for(j = 0; j + 32 <= n; j += 32) {
+		for(k = 0; k < 4; k++) {
+			m[k] = _mm256_or_si256(
+				_mm256_cmpgt_epi32(_mm256_loadu_si256((const __m256i *)(top + j + 8 * k)), vi),
+				_mm256_cmpgt_epi32(_mm256_loadu_si256((const __m256i *)(bottom + j + 8 * k)), vlim)
+			);
+		}
+		/* Packing works within 128 bit lanes, put the bytes back in order */
+		m[0] = _mm256_packs_epi16(_mm256_packs_epi32(m[0], m[1]), _mm256_packs_epi32(m[2], m[3]));
+		m[0] = _mm256_permutevar8x32_epi32(m[0], order);
+
+		v = _mm256_loadu_si256((const __m256i *)(row + j));
+		v = _mm256_blendv_epi8(v, ten, m[0]);
+		_mm256_storeu_si256((__m256i *)(row + j), v);
+	}
+	Columns_Scalar(row + j, top + j, bottom + j, i, lim, n - j);
+}
+
+__attribute__((target("avx2"))) static void Planes_AVX2(const unsigned char *row, Uint64 *dig, Uint64 *solid, int n) {
+	const __m256i one = _mm256_set1_epi8(1);
+	const __m256i nine = _mm256_set1_epi8(9);
+	const __m256i ten = _mm256_set1_epi8(10);
+	__m256i v;
+	Uint64 d, s;
+	int j, k;
+
+	for(j = 0; j + 64 <= n; j += 64) {
+		d = 0;
+		s = 0;
+		for(k = 0; k < 64; k += 32) {
+			v = _mm256_loadu_si256((const __m256i *)(row + j + k));
+			d |= (Uint64)(Uint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_or_si256(v, one), nine)) << k;
+			s |= (Uint64)(Uint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(v, ten), v)) << k;
+		}
+		dig[j >> 6] = d;
+		solid[j >> 6] = s;
+	}
+	if(j < n) Planes_Word(row + j, &dig[j >> 6], &solid[j >> 6], n - j);
+}
+#endif
+
+static void (*Sand)(unsigned char *row, Uint64 key, Uint64 counter, int n) = Sand_Scalar;
+static void (*Columns)(unsigned char *row, const int *top, const int *bottom, int i, int lim, int n) = Columns_Scalar;
+static void (*Planes)(const unsigned char *row, Uint64 *dig, Uint64 *solid, int n) = Planes_Scalar;
+
+/* Build tables and select the best kernels for this CPU. Call once
+ * before any thread generates a field. */
+void Init_Terrain(void) {
+	unsigned char b[8];
+	int i, k;
+
+	for(i = 0; i < 256; i++) {
+		for(k = 0; k < 8; k++) b[k] = 8 + ((i >> k) & 1);
+		memcpy(&sand_bytes[i], b, 8);
+	}
+
+#if defined(__SSE2__)
+	if(SDL_HasSSE2()) {
+		Sand = Sand_SSE2;
+		Columns = Columns_SSE2;
+		Planes = Planes_SSE2;
+	}
+#endif
+#if defined(HAVE_AVX2_KERNELS)
+	if(SDL_HasAVX2()) {
+		Sand = Sand_AVX2;
+		Columns = Columns_AVX2;
+		Planes = Planes_AVX2;
 	}
-	for(j = BASE_DOORSIZE; j < BASE_SIZEX; j++) {
-		field[-BASE_SIZEY + y][j + x] = 30 + 10 * n;
-		field[BASE_SIZEY - 1 + y][j + x] = 30 + 10 * n;
+#endif
+}
+
+/* Set cells x0 ... x1 - 1 of row y of the base of tank n, row holding
+ * cell x0 */
+static void Base_Row(struct WORLD *w, int y, int n, unsigned char *row, int x0, int x1) {
+	int c = 30 + 10 * n;
+	int j, j0, j1;
+
+	y -= w->tank[n].basey;
+	if(y < -BASE_SIZEY || y >= BASE_SIZEY) return;
+
+	x0 -= w->tank[n].basex;
+	x1 -= w->tank[n].basex;
+	row -= x0;
+	j0 = x0 > -BASE_SIZEX ? x0 : -BASE_SIZEX;
+	j1 = x1 < BASE_SIZEX ? x1 : BASE_SIZEX;
+
+	if(y == -BASE_SIZEY || y == BASE_SIZEY - 1) {
+		/* Top or bottom, with the door */
+		for(j = j0; j < j1; j++) row[j] = (j <= -BASE_DOORSIZE || j >= BASE_DOORSIZE) ? c : 0;
+	} else {
+		for(j = j0; j < j1; j++) row[j] = (j == -BASE_SIZEX || j == BASE_SIZEX - 1) ? c : 0;
 	}
 }
 
-Wall *Generate_Wall(void) {
+/*  Generate Wall
+ *
+ *  Fills y[0] ... y[WALL_SPAN] with a wall profile by midpoint
+ *  displacement, both ends at 0. Each pass halves the spacing and the
+ *  displacement range.
+ */
+static void Generate_Wall(struct RNG *r, int y[WALL_SPAN + 1]) {
 	int x;
 	int skip;
 	int range;
-	Wall *start;
-	Wall *p;
-	Wall *newp;
-
-	skip = 64;
-	range = 40;
-
-	start = malloc(sizeof(Wall));
-	start->x = 0;
-	start->y = 0;
-	start->next = malloc(sizeof(Wall));
-	;
-	p = start->next;
-	p->x = skip;
-	p->y = 0;
-	p->next = NULL;
-
-	while(skip > 1) {
-		x = skip / 2;
-		p = start;
-
-		while(1) {
-			while(p->next != NULL && p->next->x < x) p = p->next;
-			if(p->next == NULL) break;
-
-			newp = malloc(sizeof(Wall));
-			newp->x = x;
-			newp->y = (p->y + p->next->y) / 2 - range + (int)(2.0 * (double)range * rand() / (RAND_MAX + 1.0));
-			newp->next = p->next;
-			p->next = newp;
-			p = newp->next;
-
-			x += skip;
-		}
 
-		skip = skip / 2;
-		range = range / 2;
+	y[0] = 0;
+	y[WALL_SPAN] = 0;
+
+	for(skip = WALL_SPAN, range = 40; skip > 1; skip /= 2, range /= 2) {
+		for(x = skip / 2; x < WALL_SPAN; x += skip)
+			y[x] = (y[x - skip / 2] + y[x + skip / 2]) / 2 - range + RNG_Range(r, 2 * range);
 	}
+}
 
-	return (start);
+static size_t Page_Size(void) {
+#ifndef WIN32
+	long size = sysconf(_SC_PAGESIZE);
+
+	if(size > 0) return ((size_t)size);
+#endif
+	return (4096);
+}
+
+/* Round size up to a multiple of page */
+static size_t Page_Round(size_t size, size_t page) {
+	return ((size + page - 1) / page * page);
 }
 
-void Free_Wall(Wall *wall) {
-	if(wall->next != NULL) Free_Wall(wall->next);
+/* Sizes of the parts of a sizex * sizey field block */
+static void Field_Layout(int sizex, int sizey, size_t *field_bytes, size_t *plane_bytes, size_t *wall_bytes, size_t *ready_bytes) {
+	size_t page = Page_Size();
+	size_t chunks = (size_t)((sizex + CHUNK - 1) / CHUNK + 1) * ((sizey + CHUNK - 1) / CHUNK);
 
-	free(wall);
+	*field_bytes = Page_Round(chunks * CHUNK * CHUNK, page);
+	*plane_bytes = Page_Round(chunks * CHUNK * sizeof(Uint64), page);
+	*wall_bytes = Page_Round(2 * ((size_t)sizex + sizey) * sizeof(int), page);
+	*ready_bytes = Page_Round(chunks, page);
 }
 
-void Init_Field(void) {
-	int i, j;
-	int i2, j2;
-	Wall *start;
-	Wall *p;
+/* Address space taken by the field of a sizex * sizey world. Only the
+ * pages of chunks generated so far are in memory. */
+size_t Field_Bytes(int sizex, int sizey) {
+	size_t field_bytes, plane_bytes, wall_bytes, ready_bytes;
 
-	/* Generate background sand */
-	for(i = 0; i < FIELD_SIZEY; i++)
-		for(j = 0; j < FIELD_SIZEX; j++) field[i][j] = 8 + (unsigned char)(2.0 * rand() / (RAND_MAX + 1.0));
+	Field_Layout(sizex, sizey, &field_bytes, &plane_bytes, &wall_bytes, &ready_bytes);
+	return (field_bytes + 2 * plane_bytes + wall_bytes + ready_bytes);
+}
 
-	/* Generate walls */
-	for(j = 0; j < FIELD_SIZEX; j += 64) {
-		start = Generate_Wall();
+/* Parse a field size given as WxH. Returns 0 if s is malformed or a
+ * side is out of range. */
+int Parse_Field_Size(const char *s, int *sizex, int *sizey) {
+	int x, y;
+	char c;
 
-		p = start;
-		while(p != NULL) {
-			if(j + p->x == FIELD_SIZEX) break;
+	if(sscanf(s, "%dx%d%c", &x, &y, &c) != 2) return (0);
+	if(x < FIELD_MINX || x > FIELD_MAX || y < FIELD_MINY || y > FIELD_MAX) return (0);
 
-			for(i = 0; i < 100 + p->y; i++) field[i][j + p->x] = 10;
+	*sizex = x;
+	*sizey = y;
+	return (1);
+}
 
-			p = p->next;
-		}
+/* Allocate the field of w for sizex * sizey cells as a single block
+ * of zero pages, each part starting on a page of its own. Pages are
+ * only given memory when first written. */
+void Alloc_Field(struct WORLD *w, int sizex, int sizey) {
+	size_t field_bytes, plane_bytes, wall_bytes, ready_bytes;
+	char *map;
+
+	w->sizex = sizex;
+	w->sizey = sizey;
+	w->chunksx = (sizex + CHUNK - 1) / CHUNK + 1;
+	w->chunksy = (sizey + CHUNK - 1) / CHUNK;
+
+	Field_Layout(sizex, sizey, &field_bytes, &plane_bytes, &wall_bytes, &ready_bytes);
+	w->map_bytes = field_bytes + 2 * plane_bytes + wall_bytes + ready_bytes;
+
+#ifndef WIN32
+	map = mmap(NULL, w->map_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(map == MAP_FAILED) map = NULL;
+#else
+	map = VirtualAlloc(NULL, w->map_bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#endif
+	if(map == NULL) {
+		printf("Out of memory allocating a %dx%d field\n", sizex, sizey);
+		exit(1);
+	}
 
-		Free_Wall(start);
+	w->map = map;
+	w->field = (unsigned char *)map;
+	w->diggable = (Uint64 *)(map + field_bytes);
+	w->solid = (Uint64 *)(map + field_bytes + plane_bytes);
+	w->wall = (int *)(map + field_bytes + 2 * plane_bytes);
+	w->ready = (Uint8 *)(map + field_bytes + 2 * plane_bytes + wall_bytes);
+}
+
+void Free_Field(struct WORLD *w) {
+	if(w->map != NULL) {
+#ifndef WIN32
+		munmap(w->map, w->map_bytes);
+#else
+		VirtualFree(w->map, 0, MEM_RELEASE);
+#endif
 	}
+	w->map = NULL;
+	w->field = NULL;
+	w->diggable = NULL;
+	w->solid = NULL;
+	w->wall = NULL;
+	w->ready = NULL;
+}
 
-	for(j = 0; j < FIELD_SIZEX; j += 64) {
-		start = Generate_Wall();
+/* Bounds of chunk c, cells x0 ... x0 + *n - 1 of rows y0 ... y0 +
+ * *rows - 1. *n is 0 for the spare column. */
+static void Chunk_Bounds(const struct WORLD *w, int c, int *x0, int *y0, int *n, int *rows) {
+	*x0 = c % w->chunksx * CHUNK;
+	*y0 = c / w->chunksx * CHUNK;
+	*n = w->sizex - *x0 < CHUNK ? w->sizex - *x0 : CHUNK;
+	*rows = w->sizey - *y0 < CHUNK ? w->sizey - *y0 : CHUNK;
+	if(*n < 0) *n = 0;
+}
+
+/* Rebuild the bit planes of chunk c from w->field */
+static void Chunk_Planes(struct WORLD *w, int c) {
+	int x0, y0, n, rows;
+	int i;
+
+	Chunk_Bounds(w, c, &x0, &y0, &n, &rows);
+	for(i = y0; i < y0 + rows; i++) {
+		if(n > 0) {
+			Planes(&FIELD(w, i, x0), &PLANE(w, w->diggable, i, x0), &PLANE(w, w->solid, i, x0), n);
+		} else {
+			PLANE(w, w->diggable, i, x0) = 0;
+			PLANE(w, w->solid, i, x0) = 0;
+		}
+	}
+}
 
-		p = start;
-		while(p != NULL) {
-			if(j + p->x == FIELD_SIZEX) break;
+/* Rebuild bit planes of w from w->field */
+void Update_Planes(struct WORLD *w) {
+	int c;
 
-			for(i = 0; i < 100 + p->y; i++) field[FIELD_SIZEY - i - 1][j + p->x] = 10;
+	for(c = 0; c < w->chunksx * w->chunksy; c++) Chunk_Planes(w, c);
+}
 
-			p = p->next;
+/*  Build Chunk
+ *
+ *  Generates chunk c from the sand key, wall profiles and base positions
+ *  drawn by Init_Field(). Each cell depends only on those, so chunks can
+ *  be made in any order and the field is the same whichever parts of
+ *  it are explored. Sand takes one hash for 64 cells, counted across
+ *  rows with the spare column, so CHUNK must stay 64.
+ */
+static void Build_Chunk(struct WORLD *w, int c) {
+	const int *top = w->wall;
+	const int *bottom = top + w->sizex;
+	const int *left = bottom + w->sizex;
+	const int *right = left + w->sizey;
+	unsigned char *row;
+	int x0, y0, n, rows;
+	int i, k;
+
+	Chunk_Bounds(w, c, &x0, &y0, &n, &rows);
+
+	for(i = y0; i < y0 + rows && n > 0; i++) {
+		row = &FIELD(w, i, x0);
+
+		if(i < 50 || i >= w->sizey - 50) {
+			/* Border */
+			memset(row, 10, n);
+			continue;
 		}
 
-		Free_Wall(start);
+		/* Background sand */
+		Sand(row, w->field_key, (Uint64)i * w->chunksx + x0 / CHUNK, n);
+
+		/* Borders and walls */
+		k = (left[i] > 50 ? left[i] : 50) - x0;
+		if(k > 0) memset(row, 10, k < n ? k : n);
+		k = w->sizex - (right[i] > 50 ? right[i] : 50) - x0;
+		if(k < n) memset(row + (k > 0 ? k : 0), 10, n - (k > 0 ? k : 0));
+		if(i < w->field_depth || i >= w->sizey - w->field_depth) Columns(row, top + x0, bottom + x0, i, w->sizey - 1 - i, n);
+
+		Base_Row(w, i, 0, row, x0, x0 + n);
+		Base_Row(w, i, 1, row, x0, x0 + n);
 	}
 
-	for(j = 0; j < FIELD_SIZEY; j += 64) {
-		start = Generate_Wall();
+	/* While the chunk is still in cache */
+	Chunk_Planes(w, c);
+	w->ready[c] = 1;
+}
+
+/* Make chunk c on first touch, see Build_Chunk() */
+void Make_Chunk(struct WORLD *w, int c) {
+	Uint64 start = Clock_Real();
 
-		p = start;
-		while(p != NULL) {
-			if(j + p->x == FIELD_SIZEY) break;
+	Build_Chunk(w, c);
+	w->chunk_ns += Clock_Real() - start;
+}
 
-			for(i = 0; i < 100 + p->y; i++) field[j + p->x][i] = 10;
+/* Copy n cells of row y from x on to dst, making chunks as needed */
+void Copy_Cells(struct WORLD *w, unsigned char *dst, int y, int x, int n) {
+	int k;
 
-			p = p->next;
-		}
+	while(n > 0) {
+		k = CHUNK - (x & (CHUNK - 1));
+		if(k > n) k = n;
 
-		Free_Wall(start);
+		Touch(w, y, x);
+		memcpy(dst, &FIELD(w, y, x), k);
+		dst += k;
+		x += k;
+		n -= k;
 	}
+}
 
-	for(j = 0; j < FIELD_SIZEY; j += 64) {
-		start = Generate_Wall();
+/* Chunks of w generated so far */
+int Chunks_Ready(const struct WORLD *w) {
+	int c, n = 0;
 
-		p = start;
-		while(p != NULL) {
-			if(j + p->x == FIELD_SIZEY) break;
+	for(c = 0; c < w->chunksx * w->chunksy; c++) n += w->ready[c] != 0;
+	return (n);
+}
 
-			for(i = 0; i < 100 + p->y; i++) field[j + p->x][FIELD_SIZEX - i - 1] = 10;
+static int Field_Worker(void *data) {
+	struct FIELD_JOB *job = data;
+	struct WORLD *w = job->w;
+	int b, c;
 
-			p = p->next;
-		}
+	while((b = SDL_AtomicAdd(&job->next, 1)) < w->chunksy) {
+		for(c = b * w->chunksx; c < (b + 1) * w->chunksx; c++)
+			if(!w->ready[c]) Build_Chunk(w, c);
+	}
 
-		Free_Wall(start);
+	return (0);
+}
+
+/* Generate all chunks not yet made, in rows of chunks on Field_threads
+ * threads */
+void Generate_All(struct WORLD *w) {
+	Uint64 start = Clock_Real();
+	SDL_Thread *thread[FIELD_MAX / CHUNK];
+	struct FIELD_JOB job;
+	int threads;
+	int n;
+
+	job.w = w;
+	SDL_AtomicSet(&job.next, 0);
+
+	threads = Field_threads > 0 ? Field_threads : SDL_GetCPUCount();
+	if(threads > w->chunksy) threads = w->chunksy;
+
+	/* This thread works too */
+	for(n = 1; n < threads; n++) {
+		thread[n] = SDL_CreateThread(Field_Worker, "field", &job);
+		if(thread[n] == NULL) {
+			printf("Unable to create thread: %s\n", SDL_GetError());
+			exit(1);
+		}
 	}
+	Field_Worker(&job);
+	for(n = 1; n < threads; n++) SDL_WaitThread(thread[n], NULL);
 
-	for(i = 0; i < 50; i++)
-		for(j = 0; j < FIELD_SIZEX; j++) field[i][j] = 10;
+	w->chunk_ns += Clock_Real() - start;
+}
 
-	for(i = FIELD_SIZEY - 50; i < FIELD_SIZEY; i++)
-		for(j = 0; j < FIELD_SIZEX; j++) field[i][j] = 10;
+/*  Init Field
+ *
+ *  Draws the sand key, wall profiles and base positions from
+ *  w->terrain_rng and forgets the chunks of the previous field. Chunks
+ *  are then made as play first touches them, see Make_Chunk().
+ */
+void Init_Field(struct WORLD *w) {
+	struct RNG *r = &w->terrain_rng;
+	Uint64 start = Clock_Real();
+	size_t field_bytes, plane_bytes, wall_bytes, ready_bytes;
+	int profile[WALL_SPAN + 1];
+	int *wall;
+	int i, j, k, n;
+	int i2, j2;
+	Uint32 hi, lo;
+
+	/* Two statements, so the halves are drawn in a fixed order */
+	hi = RNG_Next(r);
+	lo = RNG_Next(r);
+	w->field_key = ((Uint64)hi << 32) | lo;
+	w->field_depth = 0;
+
+	/* Wall depths of top and bottom by column, then left and right by
+	 * row */
+	wall = w->wall;
+	for(n = 0; n < 4; n++) {
+		k = n < 2 ? w->sizex : w->sizey;
+
+		for(j = 0; j < k; j += WALL_SPAN) {
+			Generate_Wall(r, profile);
+			for(i = 0; i <= WALL_SPAN && j + i < k; i++) wall[j + i] = 100 + profile[i];
+		}
 
-	for(i = 0; i < FIELD_SIZEY; i++)
-		for(j = 0; j < 50; j++) field[i][j] = 10;
+		if(n < 2)
+			for(j = 0; j < k; j++)
+				if(wall[j] > w->field_depth) w->field_depth = wall[j];
 
-	for(i = 0; i < FIELD_SIZEY; i++)
-		for(j = FIELD_SIZEX - 50; j < FIELD_SIZEX; j++) field[i][j] = 10;
+		wall += k;
+	}
 
 	/* Set base positions */
-	i = 150 + (int)(((double)FIELD_SIZEY - 300.0) * rand() / (RAND_MAX + 1.0));
-	j = 150 + (int)(((double)FIELD_SIZEX - 300.0) * rand() / (RAND_MAX + 1.0));
-
-	Init_Base(i, j, 0);
+	i = 150 + RNG_Range(r, w->sizey - 300);
+	j = 150 + RNG_Range(r, w->sizex - 300);
 
 	do {
-		i2 = 150 + (int)(((double)FIELD_SIZEY - 300.0) * rand() / (RAND_MAX + 1.0));
-		j2 = 150 + (int)(((double)FIELD_SIZEX - 300.0) * rand() / (RAND_MAX + 1.0));
+		i2 = 150 + RNG_Range(r, w->sizey - 300);
+		j2 = 150 + RNG_Range(r, w->sizex - 300);
 	} while((i - i2) * (i - i2) + (j - j2) * (j - j2) < 150 * 150);
 
-	Init_Base(i2, j2, 1);
+	w->tank[0].basex = j;
+	w->tank[0].basey = i;
+	w->tank[1].basex = j2;
+	w->tank[1].basey = i2;
+
+	/* Give back the pages of the previous field */
+	Field_Layout(w->sizex, w->sizey, &field_bytes, &plane_bytes, &wall_bytes, &ready_bytes);
+#if !defined(WIN32) && defined(MADV_DONTNEED)
+	madvise(w->map, field_bytes + 2 * plane_bytes, MADV_DONTNEED);
+#endif
+	memset(w->ready, 0, (size_t)w->chunksx * w->chunksy);
+
+	w->field_ns = Clock_Real() - start;
+	w->chunk_ns = 0;
 }
 
 /* End of file terrain.c */
@@ -28,10 +28,126 @@
 #ifndef TUNNELER_TERRAIN_H
 #define TUNNELER_TERRAIN_H
 
-#include "game.h"
+#include "types.h"
 
-extern unsigned char field[FIELD_SIZEY][FIELD_SIZEX];
+/*  Field chunks
+ *
+ *  The field is stored in chunks of CHUNK * CHUNK cells, each in a page
+ *  of its own, with chunks of a chunk row side by side. A chunk is
+ *  generated on its first touch, so only pages of the explored part of
+ *  a field are ever used. Readers and writers go through Touch() or
+ *  Touch_Area() first, or the functions below which call them.
+ */
+#define CHUNK_SHIFT 6
+#define CHUNK (1 << CHUNK_SHIFT)
+
+/* Index of the chunk holding (x, y) */
+#define CHUNK_AT(w, y, x) (((y) >> CHUNK_SHIFT) * (w)->chunksx + ((x) >> CHUNK_SHIFT))
+
+/* Cell (x, y) of the field of w, in chunk c */
+#define CHUNK_CELL(w, c, y, x) ((w)->field[((size_t)(c) << (2 * CHUNK_SHIFT)) + (((y) & (CHUNK - 1)) << CHUNK_SHIFT) + ((x) & (CHUNK - 1))])
+
+/* Cell (x, y) of the field of w */
+#define FIELD(w, y, x) CHUNK_CELL(w, CHUNK_AT(w, y, x), y, x)
+
+/* Words in a column of a bit plane, one word wide */
+#define PLANE_ROWS(w) ((size_t)(w)->chunksy << CHUNK_SHIFT)
+
+/* Word holding bit of (x, y) in a bit plane of w. Planes are stored a
+ * column at a time, so the words of a chunk are together, rows next to
+ * each other are next to each other and the next column is PLANE_ROWS()
+ * words on. */
+#define PLANE(w, plane, y, x) ((plane)[((x) >> CHUNK_SHIFT) * PLANE_ROWS(w) + (y)])
+
+void Make_Chunk(struct WORLD *w, int c);
+
+/* Generate the chunk holding (x, y) unless already done. Returns the
+ * index of the chunk. */
+static inline int Touch(struct WORLD *w, int y, int x) {
+	int c = CHUNK_AT(w, y, x);
+
+	if(!w->ready[c]) Make_Chunk(w, c);
+	return (c);
+}
+
+/* Touch every chunk with cells in rows y0 ... y1 and columns x0 ...
+ * x1, clipped to the field. Cheaper than touching cell by cell before
+ * reading an area. */
+static inline void Touch_Area(struct WORLD *w, int y0, int x0, int y1, int x1) {
+	int cy, cx, c;
+
+	if(y0 < 0) y0 = 0;
+	if(x0 < 0) x0 = 0;
+	if(y1 >= w->sizey) y1 = w->sizey - 1;
+	if(x1 >= w->sizex) x1 = w->sizex - 1;
+
+	for(cy = y0 >> CHUNK_SHIFT; cy <= y1 >> CHUNK_SHIFT; cy++) {
+		for(cx = x0 >> CHUNK_SHIFT; cx <= x1 >> CHUNK_SHIFT; cx++) {
+			c = cy * w->chunksx + cx;
+			if(!w->ready[c]) Make_Chunk(w, c);
+		}
+	}
+}
+
+/*  Field bit planes
+ *
+ *  Bit x % 64 of PLANE(w, w->diggable, y, x) is set if there is earth
+ *  at (x, y), and of PLANE(w, w->solid, y, x) if there is rock or a
+ *  wall. Writers of w->field must keep them in sync, with Dig() or
+ *  Update_Planes().
+ */
+static inline int Is_Diggable(struct WORLD *w, int y, int x) {
+	Touch(w, y, x);
+	return ((PLANE(w, w->diggable, y, x) >> (x & 63)) & 1);
+}
+
+static inline int Is_Solid(struct WORLD *w, int y, int x) {
+	Touch(w, y, x);
+	return ((PLANE(w, w->solid, y, x) >> (x & 63)) & 1);
+}
+
+static inline int Is_Empty(struct WORLD *w, int y, int x) {
+	Touch(w, y, x);
+	return (!(((PLANE(w, w->diggable, y, x) | PLANE(w, w->solid, y, x)) >> (x & 63)) & 1));
+}
+
+/* Bit of (x, y) in a plane, its chunk already touched */
+#define PLANE_BIT(w, plane, y, x) ((PLANE(w, plane, y, x) >> ((x) & 63)) & 1)
+
+/* Bits for cells x0 ... x0 + 63 of row y of a plane, x0 in bit 0. The
+ * cells used must have been touched, see Touch_Area(); cells of chunks
+ * not yet made read as zero. */
+static inline Uint64 Plane_Bits(const struct WORLD *w, const Uint64 *plane, int y, int x0) {
+	const Uint64 *p = &PLANE(w, plane, y, x0);
+	int b = x0 & 63;
+
+	/* Shift in two steps, shifting by 64 is undefined */
+	return ((p[0] >> b) | ((p[PLANE_ROWS(w)] << 1) << (63 - b)));
+}
+
+/* Clear earth at (x, y), leave anything else alone */
+static inline void Dig(struct WORLD *w, int y, int x) {
+	Uint64 bit = (Uint64)1 << (x & 63);
+	int c = Touch(w, y, x);
+
+	if(PLANE(w, w->diggable, y, x) & bit) {
+		PLANE(w, w->diggable, y, x) &= ~bit;
+		CHUNK_CELL(w, c, y, x) = 0;
+	}
+}
+
+extern int Field_threads;
 
-void Init_Field(void);
+void Init_Terrain(void);
+void Expand_Sand(unsigned char *cells, const unsigned char *bits, size_t first, size_t n);
+size_t Field_Bytes(int sizex, int sizey);
+int Parse_Field_Size(const char *s, int *sizex, int *sizey);
+void Alloc_Field(struct WORLD *w, int sizex, int sizey);
+void Free_Field(struct WORLD *w);
+void Copy_Cells(struct WORLD *w, unsigned char *dst, int y, int x, int n);
+void Update_Planes(struct WORLD *w);
+void Init_Field(struct WORLD *w);
+void Generate_All(struct WORLD *w);
+int Chunks_Ready(const struct WORLD *w);
 
 #endif /* End of file terrain.h */
@@ -25,20 +25,115 @@
  * directly via email at tvkalvas@cc.jyu.fi
  */
 
+#include "timer.h"
+#include "tunneler.h"
 #include <SDL2/SDL.h>
+#include <math.h>
+#include <stdio.h>
 
-Uint32 now, old;
+/* Time to busy-wait before a frame is due, in seconds. SDL_Delay()
+ * is not trusted to wake up any more accurately than this. */
+#define SPIN_TIME 0.002
 
-Uint32 Time_Now(void) {
-	return (now);
+static Uint64 freq;
+static Uint64 real_base;
+
+static Uint64 timer_old;
+
+/* Target frame rate, 0 for uncapped */
+int Frame_rate = 60;
+
+static Uint64 frame_next; /* When the next frame is due */
+static Uint64 frame_last; /* When the previous frame was released */
+
+/* Frame time statistics */
+static Uint64 stat_start;
+static Uint32 stat_frames;
+static double stat_sum, stat_sum2, stat_max;
+
+/* Read the performance counter frequency and start Clock_Real() at
+ * zero. Call once before any thread reads the clock. */
+void Init_Clock(void) {
+	freq = SDL_GetPerformanceFrequency();
+	real_base = SDL_GetPerformanceCounter();
+}
+
+/* Monotonic real time in ns, from the performance counter */
+Uint64 Clock_Real(void) {
+	Uint64 c;
+
+	/* Split to avoid overflowing c * NS_PER_SEC */
+	c = SDL_GetPerformanceCounter() - real_base;
+	return ((c / freq) * NS_PER_SEC + (c % freq) * NS_PER_SEC / freq);
 }
 
 void Init_Timer(void) {
-	now = SDL_GetTicks();
+	timer_old = Clock_Real();
+}
+
+/* Real time passed since the previous call, in ns */
+Uint64 Timer(void) {
+	Uint64 old = timer_old;
+
+	timer_old = Clock_Real();
+	return (timer_old - old);
 }
 
-double Timer(void) {
-	old = now;
-	now = SDL_GetTicks();
-	return ((now - old) / 1000.0);
+static void Reset_Frame_Stats(void) {
+	stat_start = frame_last;
+	stat_frames = 0;
+	stat_sum = 0.0;
+	stat_sum2 = 0.0;
+	stat_max = 0.0;
+}
+
+void Init_Limiter(void) {
+	frame_last = Clock_Real();
+	frame_next = frame_last;
+	Reset_Frame_Stats();
+}
+
+/* Wait until the next frame is due. Sleeps most of the time and
+ * spins for the last SPIN_TIME to release the frame on time. Always
+ * paced by real time. */
+void Limit_Frame(void) {
+	Uint64 t, period, spin;
+	double ft, mean;
+
+	t = Clock_Real();
+
+	if(Frame_rate > 0) {
+		period = NS_PER_SEC / Frame_rate;
+		spin = NS_PER_SEC * SPIN_TIME;
+		frame_next += period;
+
+		if(t > frame_next + period) {
+			/* Too late to catch up, start over from now */
+			frame_next = t;
+		} else if(t < frame_next) {
+			if(frame_next - t > spin) SDL_Delay((frame_next - t - spin) / NS_PER_MS);
+			while((t = Clock_Real()) < frame_next);
+		}
+	}
+
+	ft = (double)(t - frame_last) / NS_PER_SEC;
+	frame_last = t;
+
+	stat_frames++;
+	stat_sum += ft;
+	stat_sum2 += ft * ft;
+	if(ft > stat_max) stat_max = ft;
+
+	if(t - stat_start >= NS_PER_SEC) {
+		mean = stat_sum / stat_frames;
+		if(Debug)
+			printf(
+				"Frames: %u, avg %.3f ms, jitter %.3f ms, max %.3f ms\n",
+				stat_frames,
+				1000.0 * mean,
+				1000.0 * sqrt(fabs(stat_sum2 / stat_frames - mean * mean)),
+				1000.0 * stat_max
+			);
+		Reset_Frame_Stats();
+	}
 }
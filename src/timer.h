@@ -28,8 +28,23 @@
 #ifndef TUNNELER_TIMER_H
 #define TUNNELER_TIMER_H
 
-unsigned long Time_Now(void);
+#include <SDL2/SDL.h>
+
+#define NS_PER_SEC 1000000000ULL
+#define NS_PER_MS  1000000ULL
+
+extern int Frame_rate;
+
+/* All times are in nanoseconds. Clock_Real() is monotonic real time
+ * and paces the game loop. The simulation clock is w->time, which
+ * headless and batch runs advance without reference to real time. */
+void Init_Clock(void);
+Uint64 Clock_Real(void);
+
 void Init_Timer(void);
-double Timer(void);
+Uint64 Timer(void);
+
+void Init_Limiter(void);
+void Limit_Frame(void);
 
 #endif /* End of file timer.h */
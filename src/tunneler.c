@@ -26,9 +26,13 @@
  */
 
 #include "ai.h"
+#include "dda.h"
+#include "fixed.h"
 #include "game.h"
 #include "graphics.h"
 #include "keys.h"
+#include "particles.h"
+#include "rng.h"
 #include "terrain.h"
 #include "timer.h"
 #include "types.h"
@@ -38,22 +42,109 @@
 #include <stdlib.h>
 #include <string.h>
 
-#define CTEST_MACRO(Y, X)
-#define TUNNEL_MACRO(X) \
-	if(X == 8 || X == 9) X = 0
+/* Unit vectors of directions, 16.16 fixed point */
+#define DIAG FIX_CONST(0.707)
+const Sint32 rot_xtable[8] = {FIX_ONE, DIAG, 0, -DIAG, -FIX_ONE, -DIAG, 0, DIAG};
+const Sint32 rot_ytable[8] = {0, DIAG, FIX_ONE, DIAG, 0, -DIAG, -FIX_ONE, -DIAG};
 
-int noise0 = 0;
-int noise1 = 0;
-int max;
+/* Distances moved in one tick, 16.16 fixed point */
+#define TANK_STEP FIX_CONST(TANK_SPEED * TICK_TIME)
+#define DIG_STEP  FIX_CONST(DIG_SPEED * TICK_TIME)
+#define AMMO_STEP FIX_CONST(AMMO_SPEED * TICK_TIME)
+#define PART_STEP FIX_CONST(PART_SPEED * TICK_TIME)
 
-double rot_xtable[8] = {1.000, 0.707, 0.000, -0.707, -1.000, -0.707, 0.000, 0.707};
-double rot_ytable[8] = {0.000, 0.707, 1.000, 0.707, 0.000, -0.707, -1.000, -0.707};
+/* Seconds to ticks */
+#define TICKS(t) ((Sint32)((t) * TICK_RATE + 0.5))
 
-struct AMMO Ammo[2][128];
-struct EXPL Expl[128];
-struct TANK Tank[2];
 int tank_spr[2][7][7] = {TANK_SPRITE};
 
+/* Pre-rotated tank sprites with opacity masks, rows padded to 8 */
+#define TANK_SPR_SIZE 7
+
+struct SPRITE {
+	Uint8 pixels[TANK_SPR_SIZE][8];
+	Uint8 mask[TANK_SPR_SIZE][8];
+};
+
+static struct SPRITE tank_atlas[2][8];
+
+/* Footprints of the tank for each rotation, as (dy, dx) offsets from
+ * the tank position. Probe cells are tested by CTest() when moving,
+ * dig cells are cleared by Tank_Tunnel(). */
+#define FOOTPRINT_MAX 15
+
+struct FOOTPRINT {
+	int n;
+	struct {
+		signed char dy, dx;
+	} cell[FOOTPRINT_MAX];
+};
+
+static const struct FOOTPRINT probe[8] = {
+	/* To right */
+	{12, {{-2, 0}, {-2, 1}, {-2, 2}, {2, 0}, {2, 1}, {2, 2}, {-1, 0}, {-1, 1}, {0, 0}, {0, 1},
+	      {1, 0}, {1, 1}}},
+	/* To down and right */
+	{15, {{-1, -1}, {0, -1}, {1, -1}, {2, -1}, {-1, 0}, {0, 0}, {1, 0}, {2, 0}, {3, 0}, {-1, 1},
+	      {0, 1}, {1, 1}, {-1, 2}, {0, 2}, {0, 3}}},
+	/* To down */
+	{12, {{0, -2}, {1, -2}, {2, -2}, {0, 2}, {1, 2}, {2, 2}, {0, -1}, {1, -1}, {0, 0}, {1, 0},
+	      {0, 1}, {1, 1}}},
+	/* To down and left */
+	{15, {{-1, -1}, {-1, 0}, {-1, 1}, {0, -3}, {0, -2}, {0, -1}, {0, 0}, {0, 1}, {1, -2}, {1, -1},
+	      {1, 0}, {1, 1}, {2, -1}, {2, 0}, {3, 0}}},
+	/* To left */
+	{12, {{-2, 0}, {-2, -1}, {-2, -2}, {2, 0}, {2, -1}, {2, -2}, {-1, 0}, {-1, -1}, {0, 0},
+	      {0, -1}, {1, 0}, {1, -1}}},
+	/* To up and left */
+	{15, {{0, -3}, {0, -2}, {1, -2}, {-1, -1}, {0, -1}, {1, -1}, {-3, 0}, {-2, 0}, {-1, 0}, {0, 0},
+	      {1, 0}, {-2, 1}, {-1, 1}, {0, 1}, {1, 1}}},
+	/* To up */
+	{12, {{0, -2}, {-1, -2}, {-2, -2}, {0, 2}, {-1, 2}, {-2, 2}, {0, -1}, {-1, -1}, {0, 0},
+	      {-1, 0}, {0, 1}, {-1, 1}}},
+	/* To up and right */
+	{15, {{-3, 0}, {-2, 0}, {-2, 1}, {-1, -1}, {-1, 0}, {-1, 1}, {-1, 2}, {0, -1}, {0, 0}, {0, 1},
+	      {0, 2}, {0, 3}, {1, -1}, {1, 0}, {1, 1}}},
+};
+
+static const struct FOOTPRINT dig[8] = {
+	/* To right */
+	{15, {{-2, -2}, {-2, -1}, {-2, 0}, {2, -2}, {2, -1}, {2, 0}, {-1, -2}, {-1, -1}, {-1, 0},
+	      {0, -2}, {0, -1}, {0, 0}, {1, -2}, {1, -1}, {1, 0}}},
+	/* To down and right */
+	{14, {{0, -2}, {1, -2}, {-1, -1}, {0, -1}, {1, -1}, {2, -1}, {-2, 0}, {-1, 0}, {0, 0}, {1, 0},
+	      {-2, 1}, {-1, 1}, {0, 1}, {-1, 2}}},
+	/* To down */
+	{15, {{-2, -2}, {-1, -2}, {0, -2}, {-2, 2}, {-1, 2}, {0, 2}, {-2, -1}, {-1, -1}, {0, -1},
+	      {-2, 0}, {-1, 0}, {0, 0}, {-2, 1}, {-1, 1}, {0, 1}}},
+	/* To down and left */
+	{14, {{-2, 0}, {-2, -1}, {-1, -2}, {-1, -1}, {-1, 0}, {-1, 1}, {0, -1}, {0, 0}, {0, 1}, {0, 2},
+	      {1, 0}, {1, 1}, {1, 2}, {2, 1}}},
+	/* To left */
+	{15, {{-2, 2}, {-2, 1}, {-2, 0}, {2, 2}, {2, 1}, {2, 0}, {-1, 2}, {-1, 1}, {-1, 0}, {0, 2},
+	      {0, 1}, {0, 0}, {1, 2}, {1, 1}, {1, 0}}},
+	/* To up and left */
+	{14, {{1, -2}, {0, -1}, {1, -1}, {2, -1}, {-1, 0}, {0, 0}, {1, 0}, {2, 0}, {-2, 1}, {-1, 1},
+	      {0, 1}, {1, 1}, {-1, 2}, {0, 2}}},
+	/* To up */
+	{15, {{2, -2}, {1, -2}, {0, -2}, {2, 2}, {1, 2}, {0, 2}, {2, -1}, {1, -1}, {0, -1}, {2, 0},
+	      {1, 0}, {0, 0}, {2, 1}, {1, 1}, {0, 1}}},
+	/* To up and right */
+	{14, {{-2, -1}, {-1, -2}, {-1, -1}, {-1, 0}, {0, -2}, {0, -1}, {0, 0}, {0, 1}, {1, -1}, {1, 0},
+	      {1, 1}, {1, 2}, {2, 0}, {2, 1}}},
+};
+
+/* Footprints as one 7 bit mask per row, dy = -3 ... 3, bit dx + 3.
+ * Built by Init_Footprints(). */
+static Uint8 probe_rows[8][7];
+static Uint8 dig_rows[8][7];
+
+/* Player viewports on screen */
+static const SDL_Rect view[2] = {
+	{82, 2, 76, 90},
+	{ 2, 2, 76, 90},
+};
+
 int Round(double a) {
 	if(a - floor(a) < 0.5)
 		return ((int)floor(a));
@@ -61,83 +152,79 @@ int Round(double a) {
 		return ((int)ceil(a));
 }
 
-void DrawTank(int x, int y, int rot, int player) {
-	int i, j;
-	player = 30 + 10 * player - 1;
-
-	if(rot == 0 || rot == 1) {
-		for(j = -3; j <= 3; j++) {
-			for(i = -3; i <= 3; i++) {
-				if(tank_spr[rot][j + 3][i + 3] != 0)
-					PutPixel(x + i, y + j, color[player + tank_spr[rot][j + 3][i + 3]]);
-			}
-		}
-	} else if(rot == 2) {
-		rot = 0;
-
-		for(j = -3; j <= 3; j++) {
-			for(i = -3; i <= 3; i++) {
-				if(tank_spr[rot][j + 3][i + 3] != 0)
-					PutPixel(x + j, y + i, color[player + tank_spr[rot][j + 3][i + 3]]);
-			}
-		}
-	} else if(rot == 3 || rot == 4) {
-		if(rot == 4)
-			rot = 0;
-		else
-			rot = 1;
-
-		for(j = -3; j <= 3; j++) {
-			for(i = -3; i <= 3; i++) {
-				if(tank_spr[rot][j + 3][i + 3] != 0)
-					PutPixel(x - i, y + j, color[player + tank_spr[rot][j + 3][i + 3]]);
-			}
-		}
-	} else if(rot == 5) {
-		rot = 1;
-
-		for(j = -3; j <= 3; j++) {
-			for(i = -3; i <= 3; i++) {
-				if(tank_spr[rot][j + 3][i + 3] != 0)
-					PutPixel(x - i, y - j, color[player + tank_spr[rot][j + 3][i + 3]]);
-			}
-		}
-	} else if(rot == 6) {
-		rot = 0;
-
-		for(j = -3; j <= 3; j++) {
-			for(i = -3; i <= 3; i++) {
-				if(tank_spr[rot][j + 3][i + 3] != 0)
-					PutPixel(x + j, y - i, color[player + tank_spr[rot][j + 3][i + 3]]);
+/* Bake all rotations of the tank sprite for both players. Rotations
+ * are derived from the two base sprites by mirroring and transposing,
+ * dx = xi * i + xj * j and dy = yi * i + yj * j. */
+void Init_Sprites(void) {
+	static const int base[8] = {0, 1, 0, 1, 0, 1, 0, 1};
+	static const int xi[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+	static const int xj[8] = {0, 0, 1, 0, 0, 0, 1, 0};
+	static const int yi[8] = {0, 0, 1, 0, 0, 0, -1, 0};
+	static const int yj[8] = {1, 1, 0, 1, 1, -1, 0, -1};
+	int player, rot;
+	int i, j, dx, dy, v;
+	struct SPRITE *spr;
+
+	for(player = 0; player < 2; player++) {
+		for(rot = 0; rot < 8; rot++) {
+			spr = &tank_atlas[player][rot];
+			memset(spr, 0, sizeof(*spr));
+
+			for(j = -3; j <= 3; j++) {
+				for(i = -3; i <= 3; i++) {
+					v = tank_spr[base[rot]][j + 3][i + 3];
+					if(v == 0) continue;
+
+					dx = xi[rot] * i + xj[rot] * j;
+					dy = yi[rot] * i + yj[rot] * j;
+					spr->pixels[dy + 3][dx + 3] = 30 + 10 * player - 1 + v;
+					spr->mask[dy + 3][dx + 3] = 0xff;
+				}
 			}
 		}
-	} else if(rot == 7) {
-		rot = 1;
+	}
+}
 
-		for(j = -3; j <= 3; j++) {
-			for(i = -3; i <= 3; i++) {
-				if(tank_spr[rot][j + 3][i + 3] != 0)
-					PutPixel(x + i, y - j, color[player + tank_spr[rot][j + 3][i + 3]]);
-			}
-		}
+/* Draw tank centered at (x,y), clipped to rectangle clip */
+void DrawTank(int x, int y, int rot, int player, const SDL_Rect *clip) {
+	const struct SPRITE *spr = &tank_atlas[player][rot];
+	int i, j;
+	int i0, i1, j0, j1;
+	Uint8 *dst;
+
+	x -= 3;
+	y -= 3;
+
+	i0 = clip->x - x;
+	i1 = clip->x + clip->w - x;
+	j0 = clip->y - y;
+	j1 = clip->y + clip->h - y;
+	if(i0 < 0) i0 = 0;
+	if(j0 < 0) j0 = 0;
+	if(i1 > TANK_SPR_SIZE) i1 = TANK_SPR_SIZE;
+	if(j1 > TANK_SPR_SIZE) j1 = TANK_SPR_SIZE;
+
+	for(j = j0; j < j1; j++) {
+		dst = &framebuffer[y + j][x];
+		for(i = i0; i < i1; i++) dst[i] = (spr->pixels[j][i] & spr->mask[j][i]) | (dst[i] & ~spr->mask[j][i]);
 	}
 }
 
 void DrawShadow(int x, int y, int w, int h) {
-	DrawBox(x, y, w, 1, color[5]);
-	DrawBox(x, y, 2, h, color[5]);
+	DrawBox(x, y, w, 1, 5);
+	DrawBox(x, y, 2, h, 5);
 
-	DrawBox(x + 2, y + h - 1, w - 2, 1, color[3]);
-	DrawBox(x + w - 2, y, 2, h, color[3]);
+	DrawBox(x + 2, y + h - 1, w - 2, 1, 3);
+	DrawBox(x + w - 2, y, 2, h, 3);
 }
 
 void DrawLetter(int x, int y, char ch) {
-	Uint32 col;
+	Uint8 col;
 
 	if(ch == 'E')
-		col = color[6];
+		col = 6;
 	else
-		col = color[7];
+		col = 7;
 
 	DrawBox(x, y, 5, 1, col);
 	DrawBox(x, y + 2, 5, 1, col);
@@ -152,7 +239,7 @@ void DrawLetter(int x, int y, char ch) {
 }
 
 void DrawStatusBox(int x, int y) {
-	DrawBox(x, y, 68, 24, color[4]);
+	DrawBox(x, y, 68, 24, 4);
 	DrawShadow(x, y, 68, 24);
 
 	DrawLetter(x + 4, y + 4, 'E');
@@ -162,543 +249,280 @@ void DrawStatusBox(int x, int y) {
 }
 
 void DrawFrames(void) {
-	SDL_FillRect(screen, NULL, color[2]);
+	FillScreen(2);
 
-	DrawBox(2, 2, 76, 90, color[0]);
-	DrawBox(82, 2, 76, 90, color[0]);
+	DrawBox(2, 2, 76, 90, 0);
+	DrawBox(82, 2, 76, 90, 0);
 
 	DrawStatusBox(6, 94);
 	DrawStatusBox(86, 94);
 }
 
-void DrawNoise(int x, int y, int w, int h) {
+void DrawNoise(struct RNG *r, int x, int y, int w, int h) {
 	int i, j, n;
 
 	n = 0;
-	DrawBox(x, y, w, h, color[0]);
+	DrawBox(x, y, w, h, 0);
 
 	for(j = 0; j < h; j++) {
 		for(i = 0; i < w; i++) {
 			if(n == 0) {
-				j += 2 + (int)(5.0 * rand() / (RAND_MAX + 1.0));
-				n = 90 + (int)(1400.0 * rand() / (RAND_MAX + 1.0));
+				j += 2 + RNG_Range(r, 5);
+				n = 90 + RNG_Range(r, 1400);
 				break;
 			} else
 				n--;
 
-			PutPixel(x + i, y + j, color[50 + (int)(20.0 * rand() / (RAND_MAX + 1.0))]);
+			PutPixel(x + i, y + j, 50 + RNG_Range(r, 20));
 		}
 	}
 }
 
-int NoiseProb(double E) {
+int NoiseProb(struct RNG *r, double E) {
 	if(1.0 / (80.0 * E) > 0.50)
-		return (1.0 * rand() / (RAND_MAX + 1.0) > 0.50);
+		return (RNG_Double(r) > 0.50);
 	else
-		return (1.0 * rand() / (RAND_MAX + 1.0) > 1.0 / (80.0 * E));
+		return (RNG_Double(r) > 1.0 / (80.0 * E));
 }
 
-void Draw(void) {
+/* Interpolate between previous and current tick */
+static Sint32 Lerp(Sint32 prev, Sint32 cur, double alpha) {
+	return (prev + (Sint32)((cur - prev) * alpha));
+}
+
+/* Draw the game state interpolated by alpha (0.0 - 1.0) from the
+ * previous simulation tick towards the current one */
+void Draw(struct WORLD *w, double alpha) {
+	const struct TANK *Tank = w->tank;
+	const struct AMMO *a;
 	int x, y;
 	int i, j;
-	SDL_Rect rect;
+	int tx[2], ty[2];
+	Sint32 ax, ay;
+
+	for(i = 0; i < 2; i++) {
+		tx[i] = Fix_Round(Lerp(Tank[i].px, Tank[i].x, alpha));
+		ty[i] = Fix_Round(Lerp(Tank[i].py, Tank[i].y, alpha));
+	}
 
 	/* Draw status */
-	DrawBox(19, 98, 49, 5, color[0]);
-	DrawBox(19, 109, 49, 5, color[0]);
-	DrawBox(99, 98, 49, 5, color[0]);
-	DrawBox(99, 109, 49, 5, color[0]);
+	DrawBox(19, 98, 49, 5, 0);
+	DrawBox(19, 109, 49, 5, 0);
+	DrawBox(99, 98, 49, 5, 0);
+	DrawBox(99, 109, 49, 5, 0);
 
-	DrawBox(19, 98, 49.0 * Tank[1].Energy, 5, color[6]);
-	if(Tank[1].Shields > 0.0) DrawBox(19, 109, 49.0 * Tank[1].Shields, 5, color[7]);
+	DrawBox(19, 98, 49.0 * Tank[1].Energy, 5, 6);
+	if(Tank[1].Shields > 0.0) DrawBox(19, 109, 49.0 * Tank[1].Shields, 5, 7);
 
-	DrawBox(99, 98, 49.0 * Tank[0].Energy, 5, color[6]);
-	if(Tank[0].Shields > 0.0) DrawBox(99, 109, 49.0 * Tank[0].Shields, 5, color[7]);
+	DrawBox(99, 98, 49.0 * Tank[0].Energy, 5, 6);
+	if(Tank[0].Shields > 0.0) DrawBox(99, 109, 49.0 * Tank[0].Shields, 5, 7);
 
 	/* Draw field or noise */
-	if(Tank[0].Energy >= 0.25 || NoiseProb(Tank[0].Energy)) {
-		x = Round(Tank[0].x);
-		y = Round(Tank[0].y);
+	if(Tank[0].Energy >= 0.25 || NoiseProb(&w->fx_rng, Tank[0].Energy)) {
 		for(j = 0; j < 90; j++) {
-			for(i = 0; i < 76; i++) PutPixel(82 + i, 2 + j, color[field[y + j - 45][x + i - 38]]);
+			Copy_Cells(w, &framebuffer[2 + j][82], ty[0] + j - 45, tx[0] - 38, 76);
 		}
 	} else
-		noise0 = 2;
+		w->noise[0] = 2;
 
-	if(Tank[1].Energy >= 0.25 || NoiseProb(Tank[1].Energy)) {
-		x = Round(Tank[1].x);
-		y = Round(Tank[1].y);
+	if(Tank[1].Energy >= 0.25 || NoiseProb(&w->fx_rng, Tank[1].Energy)) {
 		for(j = 0; j < 90; j++) {
-			for(i = 0; i < 76; i++) PutPixel(2 + i, 2 + j, color[field[y + j - 45][x + i - 38]]);
+			Copy_Cells(w, &framebuffer[2 + j][2], ty[1] + j - 45, tx[1] - 38, 76);
 		}
 	} else
-		noise1 = 2;
+		w->noise[1] = 2;
 
 	/* Draw Tanks */
 	if(Tank[0].deathc <= 0.0) {
-		DrawTank(120, 47, Tank[0].rot, 0);
-
-		rect.x = Video_X * 2 / RES_X;
-		rect.y = Video_Y * 2 / RES_Y;
-		rect.w = Video_X * (2 + 76) / RES_X - Video_X * 2 / RES_X;
-		rect.h = Video_Y * (2 + 90) / RES_Y - Video_Y * 2 / RES_Y;
-
-		SDL_SetClipRect(screen, &rect);
-		DrawTank(Round(Tank[0].x) - Round(Tank[1].x) + 40, Round(Tank[0].y) - Round(Tank[1].y) + 47, Tank[0].rot, 0);
-		SDL_SetClipRect(screen, NULL);
+		DrawTank(120, 47, Tank[0].rot, 0, &view[0]);
+		DrawTank(tx[0] - tx[1] + 40, ty[0] - ty[1] + 47, Tank[0].rot, 0, &view[1]);
 	}
 	if(Tank[1].deathc <= 0.0) {
-		DrawTank(40, 47, Tank[1].rot, 1);
-
-		rect.x = Video_X * 82 / RES_X;
-		rect.y = Video_Y * 2 / RES_Y;
-		rect.w = Video_X * (82 + 76) / RES_X - Video_X * 82 / RES_X;
-		rect.h = Video_Y * (2 + 90) / RES_Y - Video_Y * 2 / RES_Y;
-
-		SDL_SetClipRect(screen, &rect);
-		DrawTank(Round(Tank[1].x) - Round(Tank[0].x) + 120, Round(Tank[1].y) - Round(Tank[0].y) + 47, Tank[1].rot, 1);
-		SDL_SetClipRect(screen, NULL);
+		DrawTank(40, 47, Tank[1].rot, 1, &view[1]);
+		DrawTank(tx[1] - tx[0] + 120, ty[1] - ty[0] + 47, Tank[1].rot, 1, &view[0]);
 	}
 
 	/* Draw Ammo */
 	for(j = 0; j < 2; j++) {
-		for(i = 0; i < 128; i++) {
+		for(i = 0; i < w->ammo[j].n; i++) {
+			a = &w->ammo[j].a[i];
+			ax = Lerp(a->px, a->x, alpha);
+			ay = Lerp(a->py, a->y, alpha);
+
 			/* Draw ammo on screen of tank 0 */
-			if(Ammo[j][i].exists) {
-				x = Round(Ammo[j][i].x) - Round(Tank[0].x);
-				y = Round(Ammo[j][i].y) - Round(Tank[0].y);
-				if(x < 38 && x >= -38 && y < 45 && y >= -45) PutPixel(x + 120, y + 47, color[12]);
-
-				x = Round(Ammo[j][i].x - rot_xtable[Ammo[j][i].rot]) - Round(Tank[0].x);
-				y = Round(Ammo[j][i].y - rot_ytable[Ammo[j][i].rot]) - Round(Tank[0].y);
-				if(x < 38 && x >= -38 && y < 45 && y >= -45) PutPixel(x + 120, y + 47, color[13]);
-			}
+			x = Fix_Round(ax) - tx[0];
+			y = Fix_Round(ay) - ty[0];
+			if(x < 38 && x >= -38 && y < 45 && y >= -45) PutPixel(x + 120, y + 47, 12);
+
+			x = Fix_Round(ax - rot_xtable[a->rot]) - tx[0];
+			y = Fix_Round(ay - rot_ytable[a->rot]) - ty[0];
+			if(x < 38 && x >= -38 && y < 45 && y >= -45) PutPixel(x + 120, y + 47, 13);
 
 			/* Draw ammo on screen of tank 1 */
-			if(Ammo[j][i].exists) {
-				x = Round(Ammo[j][i].x) - Round(Tank[1].x);
-				y = Round(Ammo[j][i].y) - Round(Tank[1].y);
-				if(x < 38 && x >= -38 && y < 45 && y >= -45) PutPixel(x + 40, y + 47, color[12]);
-
-				x = Round(Ammo[j][i].x - rot_xtable[Ammo[j][i].rot]) - Round(Tank[1].x);
-				y = Round(Ammo[j][i].y - rot_ytable[Ammo[j][i].rot]) - Round(Tank[1].y);
-				if(x < 38 && x >= -38 && y < 45 && y >= -45) PutPixel(x + 40, y + 47, color[13]);
-			}
+			x = Fix_Round(ax) - tx[1];
+			y = Fix_Round(ay) - ty[1];
+			if(x < 38 && x >= -38 && y < 45 && y >= -45) PutPixel(x + 40, y + 47, 12);
 
-			/* Draw explosion on screen of tank j */
-			if(Expl[i].lifetime > 0.0 && Round(Expl[i].x) - Round(Tank[j].x) < 38 &&
-			   Round(Expl[i].x) - Round(Tank[j].x) >= -38 && Round(Expl[i].y) - Round(Tank[j].y) < 45 &&
-			   Round(Expl[i].y) - Round(Tank[j].y) >= -45) {
-				PutPixel(
-					Round(Expl[i].x) - Round(Tank[j].x) + 120 - 80 * j,
-					Round(Expl[i].y) - Round(Tank[j].y) + 47,
-					color[12]
-				);
-			}
+			x = Fix_Round(ax - rot_xtable[a->rot]) - tx[1];
+			y = Fix_Round(ay - rot_ytable[a->rot]) - ty[1];
+			if(x < 38 && x >= -38 && y < 45 && y >= -45) PutPixel(x + 40, y + 47, 13);
+		}
+	}
+
+	/* Draw explosions on screens of both tanks */
+	for(i = 0; i < w->expl.n; i++) {
+		for(j = 0; j < 2; j++) {
+			x = Fix_Round(w->expl.x[i]) - tx[j];
+			y = Fix_Round(w->expl.y[i]) - ty[j];
+			if(x < 38 && x >= -38 && y < 45 && y >= -45) PutPixel(x + 120 - 80 * j, y + 47, 12);
 		}
 	}
 
 	/* Draw noise */
-	if(noise0) {
-		DrawNoise(82, 2, 76, 90);
-		noise0--;
+	if(w->noise[0]) {
+		DrawNoise(&w->fx_rng, 82, 2, 76, 90);
+		w->noise[0]--;
 	}
-	if(noise1) {
-		DrawNoise(2, 2, 76, 90);
-		noise1--;
+	if(w->noise[1]) {
+		DrawNoise(&w->fx_rng, 2, 2, 76, 90);
+		w->noise[1]--;
 	}
 }
 
-void Explosion(double x, double y, int n, int type) {
-	double rot;
-	int i, j;
+/* Take a free slot from pool p, NULL if it is full */
+static struct AMMO *New_Ammo(struct AMMO_POOL *p) {
+	if(p->n == p->max) return (NULL);
 
-	for(i = 0; i < n; i++) {
-		for(j = 0; j < 128; j++) {
-			if(Expl[j].lifetime <= 0.0 && type == 0) {
-				Expl[j].x = x;
-				Expl[j].y = y;
-				rot = 2.0 * M_PI * rand() / (RAND_MAX + 1.0);
-				Expl[j].vx = sin(rot);
-				Expl[j].vy = cos(rot);
-				Expl[j].lifetime = 0.25;
+	return (&p->a[p->n++]);
+}
 
-				break;
-			} else if(Expl[j].lifetime <= 0.0) {
-				Expl[j].x = x;
-				Expl[j].y = y;
-				rot = 2.0 * M_PI * rand() / (RAND_MAX + 1.0);
-				Expl[j].vx = 0.5 * sin(rot);
-				Expl[j].vy = 0.5 * cos(rot);
-				Expl[j].lifetime = 0.7;
+/* Release slot j of pool p by moving the last live object in it */
+static void Free_Ammo(struct AMMO_POOL *p, int j) {
+	p->a[j] = p->a[--p->n];
+}
 
-				break;
-			}
-		}
+/* Spray n particles from (x, y), 16.16 fixed point. Type 0 is a shot
+ * hitting something, otherwise a tank blowing up. */
+void Explosion(struct WORLD *w, Sint32 x, Sint32 y, int n, int type) {
+	Sint32 *vx = part_xtable;
+	Sint32 *vy = part_ytable;
+	int ok;
+	int i, r;
+
+	for(i = 0; i < n; i++) {
+		r = RNG_Range(&w->game_rng, PART_DIRS);
+		if(type == 0)
+			ok = Spawn_Particle(&w->expl, x, y, Fix_Mul(vx[r], PART_STEP), Fix_Mul(vy[r], PART_STEP), TICKS(0.25));
+		else
+			ok = Spawn_Particle(&w->expl, x, y, Fix_Mul(vx[r], PART_STEP / 2), Fix_Mul(vy[r], PART_STEP / 2), TICKS(0.7));
+
+		if(!ok) break;
 	}
 }
 
-void CTest_Sub(int y, int x, int i) {
-	int y0, x0;
+/* Build row masks of footprints. Call once before any thread runs
+ * the simulation. */
+void Init_Footprints(void) {
+	int rot, k;
 
-	y0 = Round(Tank[i].y);
-	x0 = Round(Tank[i].x);
+	memset(probe_rows, 0, sizeof(probe_rows));
+	memset(dig_rows, 0, sizeof(dig_rows));
 
-	if(field[y][x] > max) max = field[y][x];
-	if(y >= y0 - 2 && y <= y0 + 2 && x >= x0 - 2 && x <= x0 + 2 && Tank[i].deathc <= 0.0) max = 50;
+	for(rot = 0; rot < 8; rot++) {
+		for(k = 0; k < probe[rot].n; k++) probe_rows[rot][probe[rot].cell[k].dy + 3] |= 1 << (probe[rot].cell[k].dx + 3);
+		for(k = 0; k < dig[rot].n; k++) dig_rows[rot][dig[rot].cell[k].dy + 3] |= 1 << (dig[rot].cell[k].dx + 3);
+	}
 }
 
-int ATest(int y, int x, int i) {
+/* A collision query hits if it finds rock, a wall or the other tank */
+static int Blocked(struct HIT hit) {
+	return (hit.tank || hit.solid);
+}
+
+/* Other tank's 5x5 box at (y,x)? Dead tanks are never hit. */
+static int Tank_At(const struct TANK *tank, int y, int x) {
 	int y0, x0;
 
-	if(i == 0)
-		i = 1;
-	else if(i == 1)
-		i = 0;
+	y0 = Fix_Round(tank->y);
+	x0 = Fix_Round(tank->x);
 
-	y0 = Round(Tank[i].y);
-	x0 = Round(Tank[i].x);
+	return (tank->deathc <= 0.0 && y >= y0 - 2 && y <= y0 + 2 && x >= x0 - 2 && x <= x0 + 2);
+}
 
-	if(y >= y0 - 2 && y <= y0 + 2 && x >= x0 - 2 && x <= x0 + 2 && Tank[i].deathc <= 0.0) return (50);
+/*  Ammo Collision Tester
+ *
+ *  Tests a single cell (y,x) of w for ammo fired by tank i. Only
+ *  changes w by generating the chunk of the cell on first touch.
+ */
+struct HIT ATest(struct WORLD *w, int i, int y, int x) {
+	struct HIT hit;
+
+	hit.earth = Is_Diggable(w, y, x);
+	hit.solid = Is_Solid(w, y, x);
+	hit.tank = Tank_At(&w->tank[!i], y, x);
 
-	return (field[y][x]);
+	return (hit);
 }
 
 /*  Collision Tester
  *
- *  Returns worst of following:
- *  8,  if there is ground (field = 8 or 9) under the tank position (y,x)
- *  10, if there is rock, wall or a tank (field = 10, 30 or 40
- *       + tankcheck) under the tank position (y,x)
- *  0   otherways
+ *  Tests the footprint of tank i with rotation rot at (y,x) of w for
+ *  earth, rock or walls and the other tank. Reads the bit planes a
+ *  row of the footprint at a time. Only changes w by generating chunks
+ *  on first touch.
  */
-int CTest(int y, int x, int rot, int i) {
-	max = 0;
-
-	if(i == 0)
-		i = 1;
-	else if(i == 1)
-		i = 0;
-
-	if(rot == 0) { /* To right */
-		CTest_Sub(y - 2, x, i);
-		CTest_Sub(y - 2, x + 1, i);
-		CTest_Sub(y - 2, x + 2, i);
-
-		CTest_Sub(y + 2, x, i);
-		CTest_Sub(y + 2, x + 1, i);
-		CTest_Sub(y + 2, x + 2, i);
-
-		CTest_Sub(y - 1, x, i);
-		CTest_Sub(y - 1, x + 1, i);
-
-		CTest_Sub(y, x, i);
-		CTest_Sub(y, x + 1, i);
-
-		CTest_Sub(y + 1, x, i);
-		CTest_Sub(y + 1, x + 1, i);
-	} else if(rot == 1) { /* To down and right */
-		CTest_Sub(y - 1, x - 1, i);
-		CTest_Sub(y, x - 1, i);
-		CTest_Sub(y + 1, x - 1, i);
-		CTest_Sub(y + 2, x - 1, i);
-
-		CTest_Sub(y - 1, x, i);
-		CTest_Sub(y, x, i);
-		CTest_Sub(y + 1, x, i);
-		CTest_Sub(y + 2, x, i);
-		CTest_Sub(y + 3, x, i);
-
-		CTest_Sub(y - 1, x + 1, i);
-		CTest_Sub(y, x + 1, i);
-		CTest_Sub(y + 1, x + 1, i);
-
-		CTest_Sub(y - 1, x + 2, i);
-		CTest_Sub(y, x + 2, i);
-
-		CTest_Sub(y, x + 3, i);
-	} else if(rot == 2) { /* To down */
-		CTest_Sub(y, x - 2, i);
-		CTest_Sub(y + 1, x - 2, i);
-		CTest_Sub(y + 2, x - 2, i);
-
-		CTest_Sub(y, x + 2, i);
-		CTest_Sub(y + 1, x + 2, i);
-		CTest_Sub(y + 2, x + 2, i);
-
-		CTest_Sub(y, x - 1, i);
-		CTest_Sub(y + 1, x - 1, i);
-
-		CTest_Sub(y, x, i);
-		CTest_Sub(y + 1, x, i);
-
-		CTest_Sub(y, x + 1, i);
-		CTest_Sub(y + 1, x + 1, i);
-	} else if(rot == 3) { /* To down and left */
-		CTest_Sub(y - 1, x - 1, i);
-		CTest_Sub(y - 1, x, i);
-		CTest_Sub(y - 1, x + 1, i);
-
-		CTest_Sub(y, x - 3, i);
-		CTest_Sub(y, x - 2, i);
-		CTest_Sub(y, x - 1, i);
-		CTest_Sub(y, x, i);
-		CTest_Sub(y, x + 1, i);
-
-		CTest_Sub(y + 1, x - 2, i);
-		CTest_Sub(y + 1, x - 1, i);
-		CTest_Sub(y + 1, x, i);
-		CTest_Sub(y + 1, x + 1, i);
-
-		CTest_Sub(y + 2, x - 1, i);
-		CTest_Sub(y + 2, x, i);
-
-		CTest_Sub(y + 3, x, i);
-	} else if(rot == 4) { /* To left */
-		CTest_Sub(y - 2, x, i);
-		CTest_Sub(y - 2, x - 1, i);
-		CTest_Sub(y - 2, x - 2, i);
-
-		CTest_Sub(y + 2, x, i);
-		CTest_Sub(y + 2, x - 1, i);
-		CTest_Sub(y + 2, x - 2, i);
-
-		CTest_Sub(y - 1, x, i);
-		CTest_Sub(y - 1, x - 1, i);
-
-		CTest_Sub(y, x - 0, i);
-		CTest_Sub(y, x - 1, i);
-
-		CTest_Sub(y + 1, x, i);
-		CTest_Sub(y + 1, x - 1, i);
-	} else if(rot == 5) { /* To up and left */
-		CTest_Sub(y, x - 3, i);
-
-		CTest_Sub(y, x - 2, i);
-		CTest_Sub(y + 1, x - 2, i);
-
-		CTest_Sub(y - 1, x - 1, i);
-		CTest_Sub(y, x - 1, i);
-		CTest_Sub(y + 1, x - 1, i);
-
-		CTest_Sub(y - 3, x, i);
-		CTest_Sub(y - 2, x, i);
-		CTest_Sub(y - 1, x, i);
-		CTest_Sub(y, x, i);
-		CTest_Sub(y + 1, x, i);
-
-		CTest_Sub(y - 2, x + 1, i);
-		CTest_Sub(y - 1, x + 1, i);
-		CTest_Sub(y, x + 1, i);
-		CTest_Sub(y + 1, x + 1, i);
-	} else if(rot == 6) { /* To up */
-		CTest_Sub(y, x - 2, i);
-		CTest_Sub(y - 1, x - 2, i);
-		CTest_Sub(y - 2, x - 2, i);
-
-		CTest_Sub(y, x + 2, i);
-		CTest_Sub(y - 1, x + 2, i);
-		CTest_Sub(y - 2, x + 2, i);
-
-		CTest_Sub(y, x - 1, i);
-		CTest_Sub(y - 1, x - 1, i);
-
-		CTest_Sub(y, x, i);
-		CTest_Sub(y - 1, x, i);
-
-		CTest_Sub(y, x + 1, i);
-		CTest_Sub(y - 1, x + 1, i);
-	} else if(rot == 7) { /* To up and right */
-		CTest_Sub(y - 3, x, i);
-
-		CTest_Sub(y - 2, x, i);
-		CTest_Sub(y - 2, x + 1, i);
-
-		CTest_Sub(y - 1, x - 1, i);
-		CTest_Sub(y - 1, x, i);
-		CTest_Sub(y - 1, x + 1, i);
-		CTest_Sub(y - 1, x + 2, i);
-
-		CTest_Sub(y, x - 1, i);
-		CTest_Sub(y, x, i);
-		CTest_Sub(y, x + 1, i);
-		CTest_Sub(y, x + 2, i);
-		CTest_Sub(y, x + 3, i);
-
-		CTest_Sub(y + 1, x - 1, i);
-		CTest_Sub(y + 1, x, i);
-		CTest_Sub(y + 1, x + 1, i);
+struct HIT CTest(struct WORLD *w, int i, int y, int x, int rot) {
+	const struct FOOTPRINT *fp = &probe[rot];
+	const Uint8 *rows = probe_rows[rot];
+	const struct TANK *other = &w->tank[!i];
+	struct HIT hit = {0, 0, 0};
+	Uint64 earth = 0;
+	Uint64 solid = 0;
+	int k, y0, x0;
+
+	Touch_Area(w, y - 3, x - 3, y + 3, x + 3);
+	for(k = 0; k < 7; k++) {
+		earth |= Plane_Bits(w, w->diggable, y - 3 + k, x - 3) & rows[k];
+		solid |= Plane_Bits(w, w->solid, y - 3 + k, x - 3) & rows[k];
+	}
+	hit.earth = earth != 0;
+	hit.solid = solid != 0;
+
+	/* Position of the other tank relative to (y,x). The footprint
+	 * reaches at most 3 cells out, the other tank 2. */
+	y0 = Fix_Round(other->y) - y;
+	x0 = Fix_Round(other->x) - x;
+	if(other->deathc <= 0.0 && abs(y0) <= 5 && abs(x0) <= 5) {
+		for(k = 0; k < fp->n; k++) {
+			if(abs(fp->cell[k].dy - y0) <= 2 && abs(fp->cell[k].dx - x0) <= 2) {
+				hit.tank = 1;
+				break;
+			}
+		}
 	}
 
-	return (max);
+	return (hit);
 }
 
 /* Clear earth under the tank */
-void Tank_Tunnel(int y, int x, int rot) {
-	if(rot == 0) {
-		TUNNEL_MACRO(field[y - 2][x - 2]);
-		TUNNEL_MACRO(field[y - 2][x - 1]);
-		TUNNEL_MACRO(field[y - 2][x]);
-
-		TUNNEL_MACRO(field[y + 2][x - 2]);
-		TUNNEL_MACRO(field[y + 2][x - 1]);
-		TUNNEL_MACRO(field[y + 2][x]);
-
-		TUNNEL_MACRO(field[y - 1][x - 2]);
-		TUNNEL_MACRO(field[y - 1][x - 1]);
-		TUNNEL_MACRO(field[y - 1][x]);
-
-		TUNNEL_MACRO(field[y][x - 2]);
-		TUNNEL_MACRO(field[y][x - 1]);
-		TUNNEL_MACRO(field[y][x]);
-
-		TUNNEL_MACRO(field[y + 1][x - 2]);
-		TUNNEL_MACRO(field[y + 1][x - 1]);
-		TUNNEL_MACRO(field[y + 1][x]);
-	} else if(rot == 1) { /* To down and right */
-		TUNNEL_MACRO(field[y][x - 2]);
-		TUNNEL_MACRO(field[y + 1][x - 2]);
-
-		TUNNEL_MACRO(field[y - 1][x - 1]);
-		TUNNEL_MACRO(field[y][x - 1]);
-		TUNNEL_MACRO(field[y + 1][x - 1]);
-		TUNNEL_MACRO(field[y + 2][x - 1]);
-
-		TUNNEL_MACRO(field[y - 2][x]);
-		TUNNEL_MACRO(field[y - 1][x]);
-		TUNNEL_MACRO(field[y][x]);
-		TUNNEL_MACRO(field[y + 1][x]);
-
-		TUNNEL_MACRO(field[y - 2][x + 1]);
-		TUNNEL_MACRO(field[y - 1][x + 1]);
-		TUNNEL_MACRO(field[y][x + 1]);
-
-		TUNNEL_MACRO(field[y - 1][x + 2]);
-	} else if(rot == 2) { /* To down */
-		TUNNEL_MACRO(field[y - 2][x - 2]);
-		TUNNEL_MACRO(field[y - 1][x - 2]);
-		TUNNEL_MACRO(field[y][x - 2]);
-
-		TUNNEL_MACRO(field[y - 2][x + 2]);
-		TUNNEL_MACRO(field[y - 1][x + 2]);
-		TUNNEL_MACRO(field[y][x + 2]);
-
-		TUNNEL_MACRO(field[y - 2][x - 1]);
-		TUNNEL_MACRO(field[y - 1][x - 1]);
-		TUNNEL_MACRO(field[y][x - 1]);
-
-		TUNNEL_MACRO(field[y - 2][x]);
-		TUNNEL_MACRO(field[y - 1][x]);
-		TUNNEL_MACRO(field[y][x]);
-
-		TUNNEL_MACRO(field[y - 2][x + 1]);
-		TUNNEL_MACRO(field[y - 1][x + 1]);
-		TUNNEL_MACRO(field[y][x + 1]);
-	} else if(rot == 3) { /* To down and left */
-		TUNNEL_MACRO(field[y - 2][x]);
-		TUNNEL_MACRO(field[y - 2][x - 1]);
-
-		TUNNEL_MACRO(field[y - 1][x - 2]);
-		TUNNEL_MACRO(field[y - 1][x - 1]);
-		TUNNEL_MACRO(field[y - 1][x]);
-		TUNNEL_MACRO(field[y - 1][x + 1]);
-
-		TUNNEL_MACRO(field[y][x - 1]);
-		TUNNEL_MACRO(field[y][x]);
-		TUNNEL_MACRO(field[y][x + 1]);
-		TUNNEL_MACRO(field[y][x + 2]);
-
-		TUNNEL_MACRO(field[y + 1][x]);
-		TUNNEL_MACRO(field[y + 1][x + 1]);
-		TUNNEL_MACRO(field[y + 1][x + 2]);
-
-		TUNNEL_MACRO(field[y + 2][x + 1]);
-	} else if(rot == 4) /* To left */
-	{
-		TUNNEL_MACRO(field[y - 2][x + 2]);
-		TUNNEL_MACRO(field[y - 2][x + 1]);
-		TUNNEL_MACRO(field[y - 2][x]);
-
-		TUNNEL_MACRO(field[y + 2][x + 2]);
-		TUNNEL_MACRO(field[y + 2][x + 1]);
-		TUNNEL_MACRO(field[y + 2][x]);
-
-		TUNNEL_MACRO(field[y - 1][x + 2]);
-		TUNNEL_MACRO(field[y - 1][x + 1]);
-		TUNNEL_MACRO(field[y - 1][x]);
-
-		TUNNEL_MACRO(field[y][x + 2]);
-		TUNNEL_MACRO(field[y][x + 1]);
-		TUNNEL_MACRO(field[y][x]);
-
-		TUNNEL_MACRO(field[y + 1][x + 2]);
-		TUNNEL_MACRO(field[y + 1][x + 1]);
-		TUNNEL_MACRO(field[y + 1][x]);
-	} else if(rot == 5) /* To up and left */
-	{
-		TUNNEL_MACRO(field[y + 1][x - 2]);
-
-		TUNNEL_MACRO(field[y][x - 1]);
-		TUNNEL_MACRO(field[y + 1][x - 1]);
-		TUNNEL_MACRO(field[y + 2][x - 1]);
-
-		TUNNEL_MACRO(field[y - 1][x]);
-		TUNNEL_MACRO(field[y][x]);
-		TUNNEL_MACRO(field[y + 1][x]);
-		TUNNEL_MACRO(field[y + 2][x]);
-
-		TUNNEL_MACRO(field[y - 2][x + 1]);
-		TUNNEL_MACRO(field[y - 1][x + 1]);
-		TUNNEL_MACRO(field[y][x + 1]);
-		TUNNEL_MACRO(field[y + 1][x + 1]);
-
-		TUNNEL_MACRO(field[y - 1][x + 2]);
-		TUNNEL_MACRO(field[y][x + 2]);
-	} else if(rot == 6) /* To up */
-	{
-		TUNNEL_MACRO(field[y + 2][x - 2]);
-		TUNNEL_MACRO(field[y + 1][x - 2]);
-		TUNNEL_MACRO(field[y][x - 2]);
-
-		TUNNEL_MACRO(field[y + 2][x + 2]);
-		TUNNEL_MACRO(field[y + 1][x + 2]);
-		TUNNEL_MACRO(field[y][x + 2]);
-
-		TUNNEL_MACRO(field[y + 2][x - 1]);
-		TUNNEL_MACRO(field[y + 1][x - 1]);
-		TUNNEL_MACRO(field[y][x - 1]);
-
-		TUNNEL_MACRO(field[y + 2][x]);
-		TUNNEL_MACRO(field[y + 1][x]);
-		TUNNEL_MACRO(field[y][x]);
-
-		TUNNEL_MACRO(field[y + 2][x + 1]);
-		TUNNEL_MACRO(field[y + 1][x + 1]);
-		TUNNEL_MACRO(field[y][x + 1]);
-	} else if(rot == 7) /* To up and right */
-	{
-		TUNNEL_MACRO(field[y - 2][x - 1]);
-
-		TUNNEL_MACRO(field[y - 1][x - 2]);
-		TUNNEL_MACRO(field[y - 1][x - 1]);
-		TUNNEL_MACRO(field[y - 1][x]);
-
-		TUNNEL_MACRO(field[y][x - 2]);
-		TUNNEL_MACRO(field[y][x - 1]);
-		TUNNEL_MACRO(field[y][x]);
-		TUNNEL_MACRO(field[y][x + 1]);
-
-		TUNNEL_MACRO(field[y + 1][x - 1]);
-		TUNNEL_MACRO(field[y + 1][x]);
-		TUNNEL_MACRO(field[y + 1][x + 1]);
-		TUNNEL_MACRO(field[y + 1][x + 2]);
-
-		TUNNEL_MACRO(field[y + 2][x]);
-		TUNNEL_MACRO(field[y + 2][x + 1]);
+void Tank_Tunnel(struct WORLD *w, int y, int x, int rot) {
+	const Uint8 *rows = dig_rows[rot];
+	Uint64 m;
+	int k, b;
+
+	Touch_Area(w, y - 3, x - 3, y + 3, x + 3);
+	for(k = 0; k < 7; k++) {
+		m = Plane_Bits(w, w->diggable, y - 3 + k, x - 3) & rows[k];
+
+		for(b = 0; m != 0; b++, m >>= 1) {
+			if(m & 1) Dig(w, y - 3 + k, x - 3 + b);
+		}
 	}
 }
 
-void HandleKeys(void) {
+void HandleKeys(struct WORLD *w) {
+	struct TANK *Tank = w->tank;
+	const player_keys_t *key_pl = w->keys;
 	int i;
 
 	for(i = 0; i < 2; i++) {
@@ -707,7 +531,7 @@ void HandleKeys(void) {
 		Tank[i].fire = 0;
 
 		if(Tank[i].mode == TANK_AI) {
-			Handle_AI(i);
+			Handle_AI(w, i);
 			continue;
 		}
 
@@ -743,127 +567,130 @@ void HandleKeys(void) {
 	}
 }
 
-void HandleActions(double dt) {
-	double step;
-	double dx = 0.0;
-	double dy = 0.0;
-	int val = 0;
+/* Is tank inside the base of owner */
+static int In_Base(const struct TANK *tank, const struct TANK *owner) {
+	return (tank->x <= Int_To_Fix(owner->basex + BASE_SIZEX) && tank->x >= Int_To_Fix(owner->basex - BASE_SIZEX) &&
+	        tank->y <= Int_To_Fix(owner->basey + BASE_SIZEY) && tank->y >= Int_To_Fix(owner->basey - BASE_SIZEY));
+}
+
+/* Advance world w by one tick */
+void HandleActions(struct WORLD *w) {
+	const double dt = TICK_TIME;
+	struct TANK *Tank = w->tank;
+	struct AMMO_POOL *Ammo = w->ammo;
+	struct AMMO *a;
+	struct DDA d;
+	Sint32 step;
+	Sint32 dx, dy;
+	struct HIT hit = {0, 0, 0};
 	int i, j, k;
 
-	HandleKeys();
+	HandleKeys(w);
+
+	/* Remember positions of previous tick for interpolation */
+	for(i = 0; i < 2; i++) {
+		Tank[i].px = Tank[i].x;
+		Tank[i].py = Tank[i].y;
+
+		for(j = 0; j < Ammo[i].n; j++) {
+			Ammo[i].a[j].px = Ammo[i].a[j].x;
+			Ammo[i].a[j].py = Ammo[i].a[j].y;
+		}
+	}
 
 	for(i = 0; i < 2; i++) {
 		/* Align when turning */
 		if(Tank[i].oldrot != Tank[i].rot) {
-			Tank[i].y = Round(Tank[i].y);
-			Tank[i].x = Round(Tank[i].x);
+			Tank[i].y = Int_To_Fix(Fix_Round(Tank[i].y));
+			Tank[i].x = Int_To_Fix(Fix_Round(Tank[i].x));
 		}
 
 		/* Make movement */
 		if(Tank[i].move && Tank[i].deathc <= 0.0) {
 			if(!Tank[i].tunneling || Tank[i].fire)
-				step = TANK_SPEED * dt;
+				step = TANK_STEP;
 			else
-				step = DIG_SPEED * dt;
-
-			for(k = 0; 0.5 * k < step; k++) {
-				val = CTest(
-					Round(Tank[i].y + 0.5 * k * rot_ytable[Tank[i].rot]),
-					Round(Tank[i].x + 0.5 * k * rot_xtable[Tank[i].rot]),
-					Tank[i].rot,
-					i
+				step = DIG_STEP;
+
+			/* Test in half cell steps */
+			for(k = 0; k * FIX_HALF < step; k++) {
+				hit = CTest(
+					w,
+					i,
+					Fix_Round(Tank[i].y + k * rot_ytable[Tank[i].rot] / 2),
+					Fix_Round(Tank[i].x + k * rot_xtable[Tank[i].rot] / 2),
+					Tank[i].rot
 				);
-				if(val != 0) {
+				if(hit.earth || hit.solid || hit.tank) {
 					Tank[i].tunneling = 1;
-					if(!Tank[i].fire) step = DIG_SPEED * dt;
+					if(!Tank[i].fire) step = DIG_STEP;
 				}
-				if(val == 10 || val == 30 || val == 40 || val == 50) break;
+				if(Blocked(hit)) break;
 			}
 
-			if(val == 10 || val == 30 || val == 40 || val == 50) /* Rock, wall or a tank */
+			if(Blocked(hit)) /* Rock, wall or a tank */
 			{
 				if(k != 0) k--;
-				Tank[i].y = Round(Tank[i].y + 0.5 * k * rot_ytable[Tank[i].rot]);
-				Tank[i].x = Round(Tank[i].x + 0.5 * k * rot_xtable[Tank[i].rot]);
+				Tank[i].y = Int_To_Fix(Fix_Round(Tank[i].y + k * rot_ytable[Tank[i].rot] / 2));
+				Tank[i].x = Int_To_Fix(Fix_Round(Tank[i].x + k * rot_xtable[Tank[i].rot] / 2));
 			} else {
-				Tank[i].y += rot_ytable[Tank[i].rot] * step;
-				Tank[i].x += rot_xtable[Tank[i].rot] * step;
+				Tank[i].y += Fix_Mul(rot_ytable[Tank[i].rot], step);
+				Tank[i].x += Fix_Mul(rot_xtable[Tank[i].rot], step);
 			}
 
-			if(CTest(Round(Tank[i].y), Round(Tank[i].x), Tank[i].rot, i) == 0) Tank[i].tunneling = 0;
+			hit = CTest(w, i, Fix_Round(Tank[i].y), Fix_Round(Tank[i].x), Tank[i].rot);
+			if(!hit.earth && !hit.solid && !hit.tank) Tank[i].tunneling = 0;
 
-			Tank_Tunnel(Round(Tank[i].y), Round(Tank[i].x), Tank[i].rot);
+			Tank_Tunnel(w, Fix_Round(Tank[i].y), Fix_Round(Tank[i].x), Tank[i].rot);
 		}
 
 		/* Make new ammo */
-		if(Tank[i].fire && Time_Now() - Tank[i].last > FIRE_DELAY && Tank[i].deathc <= 0.0) {
-			for(j = 0; j < 128; j++) {
-				if(!Ammo[i][j].exists) {
-					Tank[i].last = Time_Now();
-					Tank[i].Energy -= ENERGY_SHOT;
-					Ammo[i][j].exists = 1;
-					Ammo[i][j].rot = Tank[i].rot;
-					Ammo[i][j].x = Round(Tank[i].x + rot_xtable[Ammo[i][j].rot]);
-					Ammo[i][j].y = Round(Tank[i].y + rot_ytable[Ammo[i][j].rot]);
-
-					break;
-				}
+		if(Tank[i].fire && w->time - Tank[i].last > FIRE_DELAY * NS_PER_MS && Tank[i].deathc <= 0.0) {
+			a = New_Ammo(&Ammo[i]);
+			if(a != NULL) {
+				Tank[i].last = w->time;
+				Tank[i].Energy -= ENERGY_SHOT;
+				a->rot = Tank[i].rot;
+				a->x = Int_To_Fix(Fix_Round(Tank[i].x + rot_xtable[a->rot]));
+				a->y = Int_To_Fix(Fix_Round(Tank[i].y + rot_ytable[a->rot]));
+				a->px = a->x;
+				a->py = a->y;
 			}
 		}
 
 		/* Ammo collisions */
-		for(j = 0; j < 128; j++) {
-			if(Ammo[i][j].exists) {
-				dx = rot_xtable[Ammo[i][j].rot] * dt * AMMO_SPEED;
-				dy = rot_ytable[Ammo[i][j].rot] * dt * AMMO_SPEED;
-
-				for(k = 0; 0.5 * k < dt * AMMO_SPEED; k++) {
-					val = ATest(
-						Round(Ammo[i][j].y + 0.5 * k * rot_ytable[Ammo[i][j].rot]),
-						Round(Ammo[i][j].x + 0.5 * k * rot_xtable[Ammo[i][j].rot]),
-						i
-					);
-					if(val != 0) break;
-				}
-
-				if(val == 8 || val == 9) {
-					field[Round(Ammo[i][j].y + 0.5 * k * rot_ytable[Ammo[i][j].rot])]
-						 [Round(Ammo[i][j].x + 0.5 * k * rot_xtable[Ammo[i][j].rot])] = 0;
-					Ammo[i][j].exists = 0;
-					Explosion(
-						Round(Ammo[i][j].x + 0.5 * k * rot_xtable[Ammo[i][j].rot]),
-						Round(Ammo[i][j].y + 0.5 * k * rot_xtable[Ammo[i][j].rot]),
-						10,
-						0
-					);
-				} else if(val == 10 || val == 30 || val == 40) {
-					k--;
-					Ammo[i][j].exists = 0;
-					Explosion(
-						Round(Ammo[i][j].x + 0.5 * k * rot_xtable[Ammo[i][j].rot]),
-						Round(Ammo[i][j].y + 0.5 * k * rot_xtable[Ammo[i][j].rot]),
-						10,
-						0
-					);
-				} else if(val == 50) /* Tank hit  */
-				{
-					Ammo[i][j].exists = 0;
-					if(i == 0)
-						Tank[1].Shields -= SHOT_DAMAGE;
-					else if(i == 1)
-						Tank[0].Shields -= SHOT_DAMAGE;
-
-					Explosion(
-						Round(Ammo[i][j].x + 0.5 * k * rot_xtable[Ammo[i][j].rot]),
-						Round(Ammo[i][j].y + 0.5 * k * rot_xtable[Ammo[i][j].rot]),
-						10,
-						0
-					);
-				} else {
-					Ammo[i][j].y += dy;
-					Ammo[i][j].x += dx;
-				}
+		for(j = 0; j < Ammo[i].n;) {
+			a = &Ammo[i].a[j];
+			dx = Fix_Mul(rot_xtable[a->rot], AMMO_STEP);
+			dy = Fix_Mul(rot_ytable[a->rot], AMMO_STEP);
+
+			DDA_Start(&d, a->x, a->y, dx, dy);
+			do {
+				hit = ATest(w, i, d.y, d.x);
+				if(hit.earth || hit.solid || hit.tank) break;
+			} while(DDA_Step(&d));
+
+			if(hit.tank) /* Tank hit  */
+			{
+				if(i == 0)
+					Tank[1].Shields -= SHOT_DAMAGE;
+				else if(i == 1)
+					Tank[0].Shields -= SHOT_DAMAGE;
+			} else if(hit.earth) {
+				Dig(w, d.y, d.x);
+			} else if(hit.solid) {
+				/* Explode in front of the rock */
+				d.x = d.px;
+				d.y = d.py;
+			} else {
+				a->y += dy;
+				a->x += dx;
+				j++;
+				continue;
 			}
+
+			Explosion(w, Int_To_Fix(d.x), Int_To_Fix(d.y), 10, 0);
+			Free_Ammo(&Ammo[i], j);
 		}
 
 		/* Use energy */
@@ -875,13 +702,15 @@ void HandleActions(double dt) {
 			if(Tank[i].deathc <= 0.0) {
 				Tank[i].rot = 6;
 				Tank[i].tunneling = 1;
-				Tank[i].x = Tank[i].basex;
-				Tank[i].y = Tank[i].basey;
+				Tank[i].x = Int_To_Fix(Tank[i].basex);
+				Tank[i].y = Int_To_Fix(Tank[i].basey);
+				Tank[i].px = Tank[i].x;
+				Tank[i].py = Tank[i].y;
 				Tank[i].Energy = 1.0;
 				Tank[i].Shields = 1.0;
 				Tank[i].deathc = 0.0;
 
-				if(CTest(Round(Tank[i].y), Round(Tank[i].x), Tank[i].rot, i) == 50) {
+				if(CTest(w, i, Fix_Round(Tank[i].y), Fix_Round(Tank[i].x), Tank[i].rot).tank) {
 					if(i == 0)
 						Tank[1].Shields = 0.0;
 					else if(i == 1)
@@ -893,20 +722,18 @@ void HandleActions(double dt) {
 		/* Death */
 		if(Tank[i].Shields <= 0.0 && Tank[i].deathc <= 0.0) {
 			Tank[i].Shields = 0.0;
-			Explosion(Tank[i].x, Tank[i].y, 30, 1);
+			Explosion(w, Tank[i].x, Tank[i].y, 30, 1);
 			Tank[i].deathc = 4.0;
 			Tank[i].deaths++;
 		} else if(Tank[i].Energy <= 0.0 && Tank[i].deathc <= 0.0) {
 			Tank[i].Energy = 0.0;
-			Explosion(Tank[i].x, Tank[i].y, 30, 1);
+			Explosion(w, Tank[i].x, Tank[i].y, 30, 1);
 			Tank[i].deathc = 4.0;
 			Tank[i].deaths++;
 		}
 
 		/* Repair Shields and Energy */
-		if(Tank[i].deathc <= 0.0 && Tank[i].x <= Tank[i].basex + BASE_SIZEX &&
-		   Tank[i].x >= Tank[i].basex - BASE_SIZEX && Tank[i].y <= Tank[i].basey + BASE_SIZEY &&
-		   Tank[i].y >= Tank[i].basey - BASE_SIZEY) {
+		if(Tank[i].deathc <= 0.0 && In_Base(&Tank[i], &Tank[i])) {
 			Tank[i].Shields += REPAIR_SPEED2 * dt;
 			Tank[i].Energy += REPAIR_SPEED1 * dt;
 
@@ -919,9 +746,7 @@ void HandleActions(double dt) {
 		else
 			j = 0;
 
-		if(Tank[i].deathc <= 0.0 && Tank[i].x <= Tank[j].basex + BASE_SIZEX &&
-		   Tank[i].x >= Tank[j].basex - BASE_SIZEX && Tank[i].y <= Tank[j].basey + BASE_SIZEY &&
-		   Tank[i].y >= Tank[j].basey - BASE_SIZEY) {
+		if(Tank[i].deathc <= 0.0 && In_Base(&Tank[i], &Tank[j])) {
 			Tank[i].Energy += REPAIR_SPEED2 * dt;
 
 			if(Tank[i].Energy > 1.0) Tank[i].Energy = 1.0;
@@ -929,48 +754,65 @@ void HandleActions(double dt) {
 	}
 
 	/* Explosion collisions */
-	for(j = 0; j < 128; j++) {
-		if(Expl[j].lifetime > 0.0) {
-			dx = Expl[j].vx * dt * PART_SPEED;
-			dy = Expl[j].vy * dt * PART_SPEED;
-
-			for(k = 0; 0.5 * k < dt * PART_SPEED; k++) {
-				val = field[Round(Expl[j].y + 0.5 * k * Expl[j].vy)][Round(Expl[j].x + 0.5 * k * Expl[j].vx)];
-				if(val != 0) break;
-			}
+	Update_Particles(w, &w->expl);
 
-			if(val == 8 || val == 9) {
-				field[Round(Expl[j].y + 0.5 * k * Expl[j].vy)][Round(Expl[j].x + 0.5 * k * Expl[j].vx)] = 0;
-				Expl[j].lifetime = 0.0;
-			} else if(val == 10 || val == 30 || val == 40) {
-				Expl[j].lifetime = 0.0;
-			} else {
-				Expl[j].y += dy;
-				Expl[j].x += dx;
-			}
+	w->time += TICK_NS;
+}
 
-			Expl[j].lifetime -= dt;
-		}
+/* Allocate a sizex * sizey field and pools of world w for max_ammo
+ * shots per tank and max_expl explosion particles */
+void Init_World(struct WORLD *w, int max_ammo, int max_expl, int sizex, int sizey) {
+	int i;
+
+	Alloc_Field(w, sizex, sizey);
+
+	for(i = 0; i < 2; i++) {
+		w->ammo[i].a = malloc(max_ammo * sizeof(struct AMMO));
+		w->ammo[i].n = 0;
+		w->ammo[i].max = max_ammo;
+	}
+
+	Alloc_Particles(&w->expl, max_expl);
+
+	if(w->ammo[0].a == NULL || w->ammo[1].a == NULL) {
+		printf("Out of memory\n");
+		exit(1);
 	}
 }
 
-void Init_Tanks(void) {
-	int i, j;
+void Free_World(struct WORLD *w) {
+	free(w->ammo[0].a);
+	free(w->ammo[1].a);
+	Free_Particles(&w->expl);
+	Free_Field(w);
+}
+
+void Init_Tanks(struct WORLD *w) {
+	struct TANK *Tank = w->tank;
+	int j;
 
 	for(j = 0; j < 2; j++) {
 		Tank[j].rot = 6;
 		Tank[j].tunneling = 1;
-		Tank[j].x = Tank[j].basex;
-		Tank[j].y = Tank[j].basey;
+		Tank[j].x = Int_To_Fix(Tank[j].basex);
+		Tank[j].y = Int_To_Fix(Tank[j].basey);
+		Tank[j].px = Tank[j].x;
+		Tank[j].py = Tank[j].y;
 		Tank[j].Energy = 1.0;
 		Tank[j].Shields = 1.0;
 		Tank[j].deathc = 0.0;
 		Tank[j].deaths = 0;
+		Tank[j].last = 0;
 
-		for(i = 0; i < 128; i++) Ammo[j][i].exists = 0;
+		w->ammo[j].n = 0;
 	}
 
-	for(j = 0; j < 128; j++) Expl[j].lifetime = 0.0;
+	w->expl.n = 0;
+
+	memset(w->keys, 0, sizeof(w->keys));
+	w->noise[0] = 0;
+	w->noise[1] = 0;
+	w->time = 0;
 }
 
 /* End of file tunneler.c */
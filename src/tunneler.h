@@ -28,17 +28,22 @@
 #ifndef TUNNELER_TUNNELER_H
 #define TUNNELER_TUNNELER_H
 
+#include "game.h"
 #include "types.h"
 
-extern struct TANK Tank[2];
+extern int Debug;
 
 int Round(double a);
-void HandleEvents(void);
+void Init_Footprints(void);
+struct HIT ATest(struct WORLD *w, int i, int y, int x);
+struct HIT CTest(struct WORLD *w, int i, int y, int x, int rot);
+void HandleEvents(struct WORLD *w);
 void DrawFrames(void);
-void Init_Tanks(void);
-void Init_Timer(void);
-double Timer(void);
-void HandleActions(double dt);
-void Draw(void);
+void Init_Sprites(void);
+void Init_World(struct WORLD *w, int max_ammo, int max_expl, int sizex, int sizey);
+void Free_World(struct WORLD *w);
+void Init_Tanks(struct WORLD *w);
+void HandleActions(struct WORLD *w);
+void Draw(struct WORLD *w, double alpha);
 
 #endif /* End of file tunneler.h */
@@ -28,6 +28,11 @@
 #ifndef TUNNELER_TYPES_H
 #define TUNNELER_TYPES_H
 
+#include "game.h"
+#include "particles.h"
+#include "rng.h"
+#include <SDL2/SDL.h>
+
 /* Tank modes */
 #define TANK_NORMAL 0
 #define TANK_AI     1
@@ -46,7 +51,8 @@ struct TANK {
 	int rot;
 	int oldrot;
 	int tunneling;
-	double x, y;
+	Sint32 x, y; /* 16.16 fixed point */
+	Sint32 px, py; /* Position on previous tick */
 	int move;
 	int fire;
 	int basex, basey;
@@ -54,19 +60,65 @@ struct TANK {
 	double Shields;
 	double deathc;
 	int deaths;
-	unsigned long last;
+	Uint64 last; /* Time of last shot */
 };
 
 struct AMMO {
-	char exists;
 	int rot;
-	double x, y;
+	Sint32 x, y; /* 16.16 fixed point */
+	Sint32 px, py; /* Position on previous tick */
+};
+
+/* Result of a collision query */
+struct HIT {
+	int earth; /* Nonzero if earth was found */
+	int solid; /* Nonzero if rock or a wall was found */
+	int tank; /* Nonzero if the other tank was hit */
+};
+
+/* Pool of shots. Live shots are packed at the start of the array, the
+ * rest of it is free. */
+struct AMMO_POOL {
+	struct AMMO *a;
+	int n; /* Live shots */
+	int max;
+};
+
+/* AI brain parameters */
+struct BRAIN {
+	Uint64 last_turn;
+	int evade;
+	Uint64 evade_time;
 };
 
-struct EXPL {
-	double lifetime;
-	double x, y;
-	double vx, vy;
+/* State of a single match. Nothing in the simulation touches globals,
+ * so any number of worlds can exist side by side. Pools and the field
+ * are allocated by Init_World(). */
+struct WORLD {
+	int sizex, sizey; /* Field size in cells */
+	int chunksx, chunksy; /* Chunks across and down, one spare column */
+	unsigned char *field; /* Cells, chunk by chunk, see terrain.h */
+	Uint64 *diggable; /* Earth (8, 9) in field */
+	Uint64 *solid; /* Rock and walls (10, 30, 40) */
+	int *wall; /* Wall depths by column and row, see Init_Field() */
+	Uint8 *ready; /* Nonzero for each chunk generated so far */
+	void *map; /* Page aligned block holding the five above */
+	size_t map_bytes;
+	Uint64 field_ns; /* Real time setting up the field, without chunks */
+	Uint64 chunk_ns; /* Real time making chunks of the field so far */
+	Uint64 field_key; /* Of the background sand */
+	int field_depth; /* Deepest top or bottom wall */
+	struct TANK tank[2];
+	struct AMMO_POOL ammo[2];
+	struct PARTICLES expl; /* Explosion particles */
+	struct BRAIN brain[2];
+	player_keys_t keys[2]; /* Current keyboard status */
+	Uint64 time; /* Simulated time in ns since Init_Tanks() */
+	int noise[2]; /* Frames of noise left on each view */
+	Uint64 seed; /* Seed given to Seed_World() */
+	struct RNG terrain_rng; /* Terrain generation */
+	struct RNG game_rng; /* Gameplay */
+	struct RNG fx_rng; /* Cosmetic effects */
 };
 
 #endif /* End of file types.h */